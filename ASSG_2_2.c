@@ -1,4 +1,38 @@
+/* ASSG_2_2.c
+ * Parent and child sort the same input in opposite orders after fork().
+ *
+ * "psort" mode sorts large arrays with a team of forked workers sharing an
+ * mmap(MAP_SHARED) region: every worker radix-sorts one chunk, then every
+ * worker k-way merges one slice of the final output. The result is sorted
+ * once; the descending order is the same array read backwards.
+ *
+ * "tsort" does the same job with pthreads: a parallel sample sort whose
+ * buckets are sorted as tasks on per-thread work-stealing deques.
+ *
+ * "bench" times the serial radix sort, psort and tsort over a range of input
+ * sizes and worker counts, with the page faults each variant takes.
+ *
+ * Compile: gcc -Wall -O2 -pthread -o assg ASSG_2_2.c
+ * Run:     ./assg
+ *          ./assg psort|tsort [-n count] [-w workers] [-s seed] [-p]
+ *          ./assg bench [-n size,...] [-w workers,...] [-r repeats]
+ *
+ * Without -n, psort and tsort read the count and elements from stdin like
+ * the interactive mode. -p prints the full ascending and descending arrays.
+ */
+
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 int arr[100], n;
@@ -46,8 +80,651 @@ void forkexample()
     }
 }
 
-int main()
+/* Anonymous shared mapping that survives fork(); NULL on failure */
+static int *shared_alloc(size_t count)
+{
+    void *p = mmap(NULL, count ? count * sizeof(int) : sizeof(int), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static void shared_free(int *p, size_t count)
+{
+    munmap(p, count ? count * sizeof(int) : sizeof(int));
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void insertion_sort(int *a, size_t len)
+{
+    for (size_t i = 1; i < len; i++) {
+        int v = a[i];
+        size_t j = i;
+        while (j > 0 && a[j - 1] > v) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = v;
+    }
+}
+
+/* LSD radix sort, 8 bits per pass, using tmp (same length) as scratch.
+ * The sign bit is flipped so negative numbers order first. Passes in
+ * which every key has the same digit are skipped.
+ */
+static void radix_sort(int *a, int *tmp, size_t len)
+{
+    if (len < 64) {
+        insertion_sort(a, len);
+        return;
+    }
+
+    size_t count[4][256];
+    memset(count, 0, sizeof(count));
+    for (size_t i = 0; i < len; i++) {
+        uint32_t k = (uint32_t)a[i] ^ 0x80000000u;
+        count[0][k & 0xff]++;
+        count[1][(k >> 8) & 0xff]++;
+        count[2][(k >> 16) & 0xff]++;
+        count[3][k >> 24]++;
+    }
+
+    int *src = a, *dst = tmp;
+    for (int pass = 0; pass < 4; pass++) {
+        int shift = pass * 8;
+        uint32_t first = (((uint32_t)src[0] ^ 0x80000000u) >> shift) & 0xff;
+        if (count[pass][first] == len)
+            continue;
+
+        size_t offset[256], sum = 0;
+        for (int b = 0; b < 256; b++) {
+            offset[b] = sum;
+            sum += count[pass][b];
+        }
+        for (size_t i = 0; i < len; i++) {
+            uint32_t k = (uint32_t)src[i] ^ 0x80000000u;
+            dst[offset[(k >> shift) & 0xff]++] = src[i];
+        }
+        int *t = src; src = dst; dst = t;
+    }
+    if (src != a)
+        memcpy(a, src, len * sizeof(int));
+}
+
+static size_t lower_bound(const int *a, size_t len, int64_t v)
+{
+    size_t lo = 0, hi = len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < v) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static size_t upper_bound(const int *a, size_t len, int64_t v)
+{
+    size_t lo = 0, hi = len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] <= v) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/* Multi-sequence selection: split k sorted runs so that exactly `rank`
+ * elements fall before the split and none of them is larger than any
+ * element after it. Ties are handed out to runs in order, so splits for
+ * increasing ranks never cross.
+ */
+static void split_runs(int *const runs[], const size_t lens[], int k, size_t rank, size_t pos[])
+{
+    int64_t lo = INT_MIN, hi = INT_MAX;
+    while (lo < hi) {                       // Smallest v with count(<= v) >= rank
+        int64_t mid = lo + (hi - lo) / 2;
+        size_t le = 0;
+        for (int i = 0; i < k; i++)
+            le += upper_bound(runs[i], lens[i], mid);
+        if (le >= rank) hi = mid; else lo = mid + 1;
+    }
+
+    size_t taken = 0;
+    for (int i = 0; i < k; i++) {
+        pos[i] = lower_bound(runs[i], lens[i], lo);
+        taken += pos[i];
+    }
+    for (int i = 0; i < k && taken < rank; i++) {
+        size_t eq = upper_bound(runs[i], lens[i], lo) - pos[i];
+        size_t add = eq < rank - taken ? eq : rank - taken;
+        pos[i] += add;
+        taken += add;
+    }
+}
+
+/* Merge k sorted runs [begin[i], end[i]) into out with a binary min-heap */
+static void kway_merge(int *const runs[], const size_t begin[], const size_t end[], int k, int *out)
+{
+    int heap[k];
+    size_t cur[k];
+    int hn = 0;
+
+    for (int i = 0; i < k; i++) {
+        cur[i] = begin[i];
+        if (cur[i] < end[i]) {
+            int j = hn++;
+            while (j > 0 && runs[heap[(j - 1) / 2]][cur[heap[(j - 1) / 2]]] > runs[i][cur[i]]) {
+                heap[j] = heap[(j - 1) / 2];
+                j = (j - 1) / 2;
+            }
+            heap[j] = i;
+        }
+    }
+
+    while (hn > 0) {
+        int r = heap[0];
+        *out++ = runs[r][cur[r]++];
+        if (cur[r] == end[r])
+            r = heap[--hn];                 // Run exhausted: sift the last one down
+        if (hn == 0)
+            break;
+
+        int v = runs[r][cur[r]], j = 0;
+        for (;;) {
+            int c = 2 * j + 1;
+            if (c >= hn) break;
+            if (c + 1 < hn && runs[heap[c + 1]][cur[heap[c + 1]]] < runs[heap[c]][cur[heap[c]]])
+                c++;
+            if (runs[heap[c]][cur[heap[c]]] >= v) break;
+            heap[j] = heap[c];
+            j = c;
+        }
+        heap[j] = r;
+    }
+}
+
+/* Run fn(w) in `workers` forked children and wait for all; -1 if any failed */
+static int fork_team(int workers, void (*fn)(int w, void *ctx), void *ctx)
+{
+    pid_t pids[workers];
+    int ok = 0;
+
+    fflush(stdout);
+    for (int w = 0; w < workers; w++) {
+        if ((pids[w] = fork()) < 0) {
+            perror("fork");
+            ok = -1;
+            workers = w;
+            break;
+        }
+        if (pids[w] == 0) {
+            fn(w, ctx);
+            _exit(0);
+        }
+    }
+    for (int w = 0; w < workers; w++) {
+        int status;
+        if (waitpid(pids[w], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ok = -1;
+    }
+    return ok;
+}
+
+struct psort_job {
+    int *src, *dst;
+    size_t n;
+    int workers;
+};
+
+static size_t chunk_start(const struct psort_job *job, int w)
+{
+    return (size_t)((unsigned __int128)job->n * w / job->workers);
+}
+
+static void sort_chunk(int w, void *ctx)
+{
+    struct psort_job *job = ctx;
+    size_t lo = chunk_start(job, w), hi = chunk_start(job, w + 1);
+    radix_sort(job->src + lo, job->dst + lo, hi - lo);   // dst doubles as scratch
+}
+
+static void merge_slice(int w, void *ctx)
+{
+    struct psort_job *job = ctx;
+    int k = job->workers;
+    int *runs[k];
+    size_t lens[k], begin[k], end[k];
+
+    for (int i = 0; i < k; i++) {
+        runs[i] = job->src + chunk_start(job, i);
+        lens[i] = chunk_start(job, i + 1) - chunk_start(job, i);
+    }
+    split_runs(runs, lens, k, chunk_start(job, w), begin);
+    split_runs(runs, lens, k, chunk_start(job, w + 1), end);
+    kway_merge(runs, begin, end, k, job->dst + chunk_start(job, w));
+}
+
+/* Sort src (shared, n ints) with forked workers; the result lands in dst
+ * (shared, n ints) and src is left holding the sorted chunks.
+ */
+static int fork_sort(int *src, int *dst, size_t n, int workers, double *sort_sec, double *merge_sec)
 {
+    struct psort_job job = { src, dst, n, workers };
+    double t0 = now_sec();
+
+    if (n < (size_t)workers * 1024)          // Not worth splitting
+        job.workers = workers = 1;
+    if (fork_team(workers, sort_chunk, &job) < 0)
+        return -1;
+    double t1 = now_sec();
+    if (workers == 1)
+        memcpy(dst, src, n * sizeof(int));
+    else if (fork_team(workers, merge_slice, &job) < 0)
+        return -1;
+    double t2 = now_sec();
+
+    if (sort_sec) *sort_sec = t1 - t0;
+    if (merge_sec) *merge_sec = t2 - t1;
+    return 0;
+}
+
+/* Thread sample sort. Thread 0 picks bucket splitters from a sample; every
+ * thread then counts and scatters its block of src into the buckets in dst;
+ * finally the buckets are radix-sorted as independent tasks. Each thread
+ * owns a deque of bucket tasks and steals from the others once it runs dry,
+ * so skewed bucket sizes do not leave threads idle.
+ */
+#define BUCKETS_PER_THREAD 8
+#define OVERSAMPLE 32
+
+struct task_deque {
+    pthread_mutex_t lock;
+    int *tasks;
+    int head, tail;                         // Owner pops at tail, thieves at head
+} __attribute__((aligned(64)));
+
+struct tsort_job {
+    int *src, *dst;
+    size_t n;
+    int threads, nbuckets;
+    int *splitters;                         // nbuckets - 1, ascending
+    uint16_t *bucket_ids;                   // Bucket of every src element
+    size_t *counts;                         // [thread][bucket], then offsets
+    size_t *bucket_start;                   // nbuckets + 1
+    struct task_deque *deques;
+    pthread_barrier_t barrier;
+};
+
+struct tsort_arg {
+    struct tsort_job *job;
+    int id;
+};
+
+static int cmp_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static inline int bucket_of(const struct tsort_job *job, int v)
+{
+    int lo = 0, hi = job->nbuckets - 1;     // Number of splitters <= v
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (job->splitters[mid] <= v) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void choose_splitters(struct tsort_job *job)
+{
+    size_t samples = (size_t)job->nbuckets * OVERSAMPLE;
+    int *sample = malloc(samples * sizeof(int));
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+
+    for (size_t i = 0; i < samples; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        sample[i] = job->src[x % job->n];
+    }
+    qsort(sample, samples, sizeof(int), cmp_int);
+    for (int b = 1; b < job->nbuckets; b++)
+        job->splitters[b - 1] = sample[(size_t)b * OVERSAMPLE];
+    free(sample);
+}
+
+static int deque_pop(struct task_deque *d, int steal)
+{
+    int task = -1;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail)
+        task = steal ? d->tasks[d->head++] : d->tasks[--d->tail];
+    pthread_mutex_unlock(&d->lock);
+    return task;
+}
+
+static void *tsort_thread(void *arg)
+{
+    struct tsort_arg *a = arg;
+    struct tsort_job *job = a->job;
+    int t = a->id, nb = job->nbuckets;
+    size_t lo = job->n * t / job->threads, hi = job->n * (t + 1) / job->threads;
+    size_t *count = job->counts + (size_t)t * nb;
+
+    if (t == 0)
+        choose_splitters(job);
+    pthread_barrier_wait(&job->barrier);
+
+    memset(count, 0, nb * sizeof(size_t));
+    for (size_t i = lo; i < hi; i++) {
+        int b = bucket_of(job, job->src[i]);
+        job->bucket_ids[i] = (uint16_t)b;
+        count[b]++;
+    }
+    pthread_barrier_wait(&job->barrier);
+
+    if (t == 0) {                           // Counts become scatter offsets
+        size_t sum = 0;
+        for (int b = 0; b < nb; b++) {
+            job->bucket_start[b] = sum;
+            for (int u = 0; u < job->threads; u++) {
+                size_t c = job->counts[(size_t)u * nb + b];
+                job->counts[(size_t)u * nb + b] = sum;
+                sum += c;
+            }
+        }
+        job->bucket_start[nb] = sum;
+    }
+    pthread_barrier_wait(&job->barrier);
+
+    for (size_t i = lo; i < hi; i++)
+        job->dst[count[job->bucket_ids[i]]++] = job->src[i];
+    pthread_barrier_wait(&job->barrier);
+
+    for (int victim = t, tried = 0; tried < job->threads; ) {
+        int b = deque_pop(&job->deques[victim], victim != t);
+        if (b < 0) {
+            victim = (victim + 1) % job->threads;
+            tried++;
+            continue;
+        }
+        size_t start = job->bucket_start[b], len = job->bucket_start[b + 1] - start;
+        radix_sort(job->dst + start, job->src + start, len);  // src is free scratch now
+        tried = 0;
+    }
+    return NULL;
+}
+
+/* Sort src into dst with pthreads; src is clobbered */
+static int thread_sort(int *src, int *dst, size_t n, int threads)
+{
+    if (n < (size_t)threads * 1024 || threads == 1) {
+        memcpy(dst, src, n * sizeof(int));
+        radix_sort(dst, src, n);
+        return 0;
+    }
+
+    struct tsort_job job = { .src = src, .dst = dst, .n = n, .threads = threads };
+    job.nbuckets = threads * BUCKETS_PER_THREAD;
+    if (job.nbuckets > 65536)
+        job.nbuckets = 65536;
+    job.bucket_ids = malloc(n * sizeof(uint16_t));
+    job.splitters = malloc((job.nbuckets - 1) * sizeof(int));
+    job.counts = malloc((size_t)threads * job.nbuckets * sizeof(size_t));
+    job.bucket_start = malloc((job.nbuckets + 1) * sizeof(size_t));
+    job.deques = aligned_alloc(64, threads * sizeof(struct task_deque));
+    pthread_barrier_init(&job.barrier, NULL, threads);
+
+    for (int t = 0; t < threads; t++) {
+        pthread_mutex_init(&job.deques[t].lock, NULL);
+        job.deques[t].tasks = malloc(job.nbuckets * sizeof(int));
+        job.deques[t].head = job.deques[t].tail = 0;
+    }
+    for (int b = 0; b < job.nbuckets; b++) {
+        struct task_deque *d = &job.deques[b % threads];
+        d->tasks[d->tail++] = b;
+    }
+
+    pthread_t tids[threads];
+    struct tsort_arg args[threads];
+    for (int t = 0; t < threads; t++) {
+        args[t] = (struct tsort_arg){ &job, t };
+        if (t > 0)
+            pthread_create(&tids[t], NULL, tsort_thread, &args[t]);
+    }
+    tsort_thread(&args[0]);
+    for (int t = 1; t < threads; t++)
+        pthread_join(tids[t], NULL);
+
+    for (int t = 0; t < threads; t++) {
+        pthread_mutex_destroy(&job.deques[t].lock);
+        free(job.deques[t].tasks);
+    }
+    pthread_barrier_destroy(&job.barrier);
+    free(job.splitters); free(job.bucket_ids); free(job.counts); free(job.bucket_start); free(job.deques);
+    return 0;
+}
+
+static void fill_random(int *a, size_t count, uint64_t seed)
+{
+    uint64_t x = seed ? seed : 88172645463325252ull;
+    for (size_t i = 0; i < count; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;    // xorshift64
+        a[i] = (int)(uint32_t)(x >> 32);
+    }
+}
+
+static int is_sorted(const int *a, size_t count)
+{
+    for (size_t i = 1; i < count; i++)
+        if (a[i - 1] > a[i])
+            return 0;
+    return 1;
+}
+
+static void print_range(const char *label, const int *a, size_t count, int descending, size_t limit)
+{
+    printf("%s: ", label);
+    for (size_t i = 0; i < count && i < limit; i++)
+        printf("%d ", descending ? a[count - 1 - i] : a[i]);
+    if (count > limit)
+        printf("... (%zu more)", count - limit);
+    printf("\n");
+}
+
+static int psort_main(int argc, char **argv, int use_threads)
+{
+    long long count = -1;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN), print_all = 0, opt;
+    uint64_t seed = 1;
+
+    while ((opt = getopt(argc, argv, "n:w:s:p")) != -1) {
+        switch (opt) {
+        case 'n': count = atoll(optarg); break;
+        case 'w': workers = atoi(optarg); break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        case 'p': print_all = 1; break;
+        default:  return 1;
+        }
+    }
+    if (workers < 1)
+        workers = 1;
+
+    int from_stdin = count < 0;
+    if (from_stdin) {
+        printf("Enter the number of elements: ");
+        if (scanf("%lld", &count) != 1 || count < 0)
+            return 1;
+        print_all = 1;
+    }
+
+    size_t len = (size_t)count;
+    int *src = shared_alloc(len), *dst = shared_alloc(len);
+    if (!src || !dst) {
+        perror("mmap");
+        return 1;
+    }
+
+    if (from_stdin) {
+        printf("Enter %zu elements to push: ", len);
+        for (size_t i = 0; i < len; i++)
+            if (scanf("%d", &src[i]) != 1)
+                return 1;
+    } else {
+        fill_random(src, len, seed);
+    }
+
+    double sort_sec = 0, merge_sec = 0;
+    if (use_threads) {
+        double t0 = now_sec();
+        thread_sort(src, dst, len, workers);
+        sort_sec = now_sec() - t0;
+    } else if (fork_sort(src, dst, len, workers, &sort_sec, &merge_sec) < 0) {
+        fprintf(stderr, "psort: a worker failed\n");
+        return 1;
+    }
+
+    size_t limit = print_all ? len : 10;
+    print_range("Sorted array (Ascending)", dst, len, 0, limit);
+    print_range("Sorted array (Descending)", dst, len, 1, limit);
+    if (!from_stdin && use_threads) {
+        printf("%zu ints, %d threads: %.3f s (%.1f M ints/s), %s\n", len, workers, sort_sec,
+               len / sort_sec / 1e6, is_sorted(dst, len) ? "verified" : "NOT SORTED");
+    } else if (!from_stdin) {
+        printf("%zu ints, %d workers: chunk sort %.3f s, merge %.3f s, total %.3f s (%.1f M ints/s), %s\n",
+               len, workers, sort_sec, merge_sec, sort_sec + merge_sec,
+               len / (sort_sec + merge_sec) / 1e6, is_sorted(dst, len) ? "verified" : "NOT SORTED");
+    }
+
+    shared_free(src, len);
+    shared_free(dst, len);
+    return 0;
+}
+
+static long minor_faults(int who)
+{
+    struct rusage ru;
+    getrusage(who, &ru);
+    return ru.ru_minflt;
+}
+
+/* Parse "a,b,c" (k/m suffixes allowed) into out[]; returns count or -1 */
+static int parse_sizes(const char *s, long long out[], int max)
+{
+    int cnt = 0;
+    char *end;
+    while (*s && cnt < max) {
+        long long v = strtoll(s, &end, 10);
+        if (end == s || v <= 0)
+            return -1;
+        if (*end == 'k' || *end == 'K') { v *= 1000; end++; }
+        else if (*end == 'm' || *end == 'M') { v *= 1000000; end++; }
+        out[cnt++] = v;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return *s ? -1 : cnt;
+}
+
+/* Serial baseline vs forked workers vs threads for each size and worker count.
+ * Faults are minor page faults taken by the sorting processes or threads:
+ * fork workers touch the shared mapping through fresh page tables.
+ */
+static int bench_main(int argc, char **argv)
+{
+    long long sizes[16] = { 100000, 1000000, 10000000, 50000000 }, workers[16];
+    int nsizes = 4, nworkers = 0, repeats = 3, opt;
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "n:w:r:")) != -1) {
+        switch (opt) {
+        case 'n': nsizes = parse_sizes(optarg, sizes, 16); break;
+        case 'w': nworkers = parse_sizes(optarg, workers, 16); break;
+        case 'r': repeats = atoi(optarg); break;
+        default:  return 1;
+        }
+    }
+    if (nsizes <= 0 || nworkers < 0 || repeats < 1) {
+        fprintf(stderr, "bench: invalid option value\n");
+        return 1;
+    }
+    if (nworkers == 0) {
+        for (long long w = 1; w < ncpu && nworkers < 15; w *= 2)
+            workers[nworkers++] = w;
+        workers[nworkers++] = ncpu;
+    }
+
+    printf("best of %d runs, times in ms\n", repeats);
+    printf("%11s %4s %10s %10s %10s %8s %8s %10s %10s\n", "ints", "w", "serial", "fork",
+           "thread", "fork x", "thread x", "fork flt", "thread flt");
+
+    for (int si = 0; si < nsizes; si++) {
+        size_t len = (size_t)sizes[si];
+        int *orig = shared_alloc(len), *src = shared_alloc(len), *dst = shared_alloc(len);
+        if (!orig || !src || !dst) {
+            perror("mmap");
+            return 1;
+        }
+        fill_random(orig, len, 42);
+
+        double serial = 1e30;
+        for (int r = 0; r < repeats; r++) {
+            memcpy(dst, orig, len * sizeof(int));
+            double t0 = now_sec();
+            radix_sort(dst, src, len);
+            double t = now_sec() - t0;
+            if (t < serial) serial = t;
+        }
+
+        for (int wi = 0; wi < nworkers; wi++) {
+            int w = (int)workers[wi];
+            double best[2] = { 1e30, 1e30 };
+            long faults[2] = { 0, 0 };
+
+            for (int variant = 0; variant < 2; variant++) {
+                for (int r = 0; r < repeats; r++) {
+                    memcpy(src, orig, len * sizeof(int));
+                    long f0 = minor_faults(RUSAGE_CHILDREN) + minor_faults(RUSAGE_SELF);
+                    double t0 = now_sec();
+                    if (variant == 0)
+                        fork_sort(src, dst, len, w, NULL, NULL);
+                    else
+                        thread_sort(src, dst, len, w);
+                    double t = now_sec() - t0;
+                    long f = minor_faults(RUSAGE_CHILDREN) + minor_faults(RUSAGE_SELF) - f0;
+                    if (!is_sorted(dst, len)) {
+                        fprintf(stderr, "bench: %s sort produced unsorted output\n",
+                                variant ? "thread" : "fork");
+                        return 1;
+                    }
+                    if (t < best[variant]) {
+                        best[variant] = t;
+                        faults[variant] = f;
+                    }
+                }
+            }
+            printf("%11zu %4d %10.2f %10.2f %10.2f %8.2f %8.2f %10ld %10ld\n", len, w,
+                   serial * 1e3, best[0] * 1e3, best[1] * 1e3,
+                   serial / best[0], serial / best[1], faults[0], faults[1]);
+        }
+
+        shared_free(orig, len);
+        shared_free(src, len);
+        shared_free(dst, len);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "psort") == 0)
+        return psort_main(argc - 1, argv + 1, 0);
+    if (argc >= 2 && strcmp(argv[1], "tsort") == 0)
+        return psort_main(argc - 1, argv + 1, 1);
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+        return bench_main(argc - 1, argv + 1);
+
     printf("Enter the number of elements: ");
     scanf("%d", &n);
 
@@ -59,4 +736,3 @@ int main()
     forkexample();
     return 0;
 }
-
@@ -1,20 +1,33 @@
 /* banker.c
  * Banker’s Algorithm simulation (safety check + request test)
  * Compile: gcc -Wall -o banker banker.c
- * Run:     ./banker
+ * Run:     ./banker [--stats]
+ *          --stats prints per-phase counters/timing on stderr (perfstats.h)
  *
  * Author: for lab use
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include "perfstats.h"
+
+int main(int argc, char **argv) {
+    struct perf_stats ps;
+    perf_stats_init(&ps, perf_stats_flag(&argc, argv));
+    perf_phase_begin(&ps, "parse");
 
-int main(void) {
     int n, m;
     printf("Enter number of processes: ");
-    if (scanf("%d", &n) != 1 || n <= 0) return 0;
+    if (scanf("%d", &n) != 1 || n <= 0) {
+        perf_stats_report(&ps);
+        return 0;
+    }
     printf("Enter number of resource types: ");
-    if (scanf("%d", &m) != 1 || m <= 0) return 0;
+    if (scanf("%d", &m) != 1 || m <= 0) {
+        perf_stats_report(&ps);
+        return 0;
+    }
 
     // Allocate matrices/vectors
     int **alloc = malloc(n * sizeof(*alloc));
@@ -44,14 +57,16 @@ int main(void) {
     // Input Available vector
     printf("\nEnter Available vector (m):\n");
     for (int j = 0; j < m; ++j) scanf("%d", &avail[j]);
+    perf_phase_end(&ps);
 
+    perf_phase_begin(&ps, "simulate");
     // Compute Need = Max - Allocation
     for (int i = 0; i < n; ++i)
         for (int j = 0; j < m; ++j) need[i][j] = max[i][j] - alloc[i][j];
 
     // Safety algorithm
     int *work = malloc(m * sizeof(*work));
-    int *finish = calloc(n, sizeof(*finish));
+    int *finish = calloc((unsigned)n, sizeof(*finish));
     int *safeSeq = malloc(n * sizeof(*safeSeq));
     for (int j = 0; j < m; ++j) work[j] = avail[j];
 
@@ -74,7 +89,9 @@ int main(void) {
         }
         if (!found) break; // no suitable process found -> unsafe
     }
+    perf_phase_end(&ps);
 
+    perf_phase_begin(&ps, "output");
     if (count == n) {
         printf("\nSystem is in a SAFE state.\nSafe sequence: ");
         for (int i = 0; i < n; ++i) {
@@ -85,6 +102,7 @@ int main(void) {
     } else {
         printf("\nSystem is in an UNSAFE state (no safe sequence found).\n");
     }
+    perf_phase_end(&ps);
 
     // Offer to test an additional request
     char choice;
@@ -139,6 +157,7 @@ int main(void) {
                     }
 
                     // safety on modified state
+                    perf_phase_begin(&ps, "simulate");
                     int cnt2 = 0;
                     int *safe2 = malloc(n * sizeof(*safe2));
                     while (cnt2 < n) {
@@ -158,7 +177,9 @@ int main(void) {
                         }
                         if (!found2) break;
                     }
+                    perf_phase_end(&ps);
 
+                    perf_phase_begin(&ps, "output");
                     if (cnt2 == n) {
                         printf("Request CAN be granted safely.\nNew safe sequence: ");
                         for (int i = 0; i < n; ++i) {
@@ -169,6 +190,7 @@ int main(void) {
                     } else {
                         printf("Request CANNOT be granted: it leads to an unsafe state.\n");
                     }
+                    perf_phase_end(&ps);
 
                     // free temporary copies
                     for (int i = 0; i < n; ++i) { free(alloc2[i]); free(need2[i]); }
@@ -187,5 +209,6 @@ int main(void) {
     free(alloc); free(max); free(need);
     free(avail); free(work); free(finish); free(safeSeq);
 
+    perf_stats_report(&ps);
     return 0;
 }
@@ -10,12 +10,15 @@
  *   ./fifo_trace
  *   ./fifo_trace 4
  *   ./fifo_trace 3 "1,2,3,4,2,1,5,6,2,1,2,3,7,6,3,2,1,2,3,6"
+ *   ./fifo_trace --stats 3 "..."   # per-phase counters/timing on stderr (perfstats.h)
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include "perfstats.h"
 
 #define MAX_REF 2048
 #define MAX_FRAMES 64
@@ -122,6 +125,10 @@ static int simulate_fifo_trace(const int refs[], int n, int frames) {
 }
 
 int main(int argc, char **argv) {
+    struct perf_stats ps;
+    perf_stats_init(&ps, perf_stats_flag(&argc, argv));
+    perf_phase_begin(&ps, "parse");
+
     int frames = 3;
     int refs[MAX_REF];
     int nrefs = 0;
@@ -149,9 +156,13 @@ int main(int argc, char **argv) {
 
     if (nrefs == 0) {
         fprintf(stderr, "No references to process. Exiting.\n");
+        perf_stats_report(&ps);
         return 1;
     }
 
+    perf_phase_end(&ps);
+
+    perf_phase_begin(&ps, "output");
     printf("\nRunning FIFO page replacement trace\n");
     printf("Reference string (%d refs): ", nrefs);
     for (int i = 0; i < nrefs; ++i) {
@@ -160,7 +171,13 @@ int main(int argc, char **argv) {
     }
     printf("\nFrames = %d\n", frames);
 
+    perf_phase_end(&ps);
+
+    perf_phase_begin(&ps, "simulate");
     simulate_fifo_trace(refs, nrefs, frames);
+    perf_phase_end(&ps);
+
+    perf_phase_begin(&ps, "output");
 
     /* example address calc (from earlier lab) */
     int logical = 2700, page_size = 1024;
@@ -168,6 +185,8 @@ int main(int argc, char **argv) {
     int offset = logical - page_number * page_size;
     printf("\nExample: Logical address = %d, page size = %d bytes -> page = %d, offset = %d\n",
            logical, page_size, page_number, offset);
+    perf_phase_end(&ps);
 
+    perf_stats_report(&ps);
     return 0;
 }
@@ -9,12 +9,15 @@
  *   ./lru_trace                # default frames = 3, default reference string
  *   ./lru_trace 4              # frames = 4, default reference string
  *   ./lru_trace 3 "1,2,3,4,2,1,5,6,..."  # frames = 3 and custom ref string
+ *   ./lru_trace --stats 3 "..."          # per-phase counters/timing on stderr (perfstats.h)
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include "perfstats.h"
 
 #define MAX_REF 2048
 #define MAX_FRAMES 32
@@ -119,6 +122,10 @@ static int simulate_lru_verbose(const int refs[], int n, int frames) {
 }
 
 int main(int argc, char **argv) {
+    struct perf_stats ps;
+    perf_stats_init(&ps, perf_stats_flag(&argc, argv));
+    perf_phase_begin(&ps, "parse");
+
     int frames = 3;
     int refs[MAX_REF];
     int nrefs;
@@ -143,6 +150,9 @@ int main(int argc, char **argv) {
         nrefs = parse_refs(default_ref_str, refs, MAX_REF);
     }
 
+    perf_phase_end(&ps);
+
+    perf_phase_begin(&ps, "output");
     printf("\nRunning LRU page replacement trace\n");
     printf("Reference string (%d refs): ", nrefs);
     for (int i = 0; i < nrefs; ++i) {
@@ -151,7 +161,13 @@ int main(int argc, char **argv) {
     }
     printf("\nFrames = %d\n", frames);
 
+    perf_phase_end(&ps);
+
+    perf_phase_begin(&ps, "simulate");
     simulate_lru_verbose(refs, nrefs, frames);
+    perf_phase_end(&ps);
+
+    perf_phase_begin(&ps, "output");
 
     /* example page / offset calculation (kept from original lab) */
     int logical = 2700, page_size = 1024;
@@ -159,6 +175,8 @@ int main(int argc, char **argv) {
     int offset = logical - page_number * page_size;
     printf("\nExample: Logical address = %d, page size = %d bytes -> page = %d, offset = %d\n",
            logical, page_size, page_number, offset);
+    perf_phase_end(&ps);
 
+    perf_stats_report(&ps);
     return 0;
 }
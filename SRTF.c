@@ -1,18 +1,28 @@
 /* srtf.c
  * Shortest Remaining Time First (SRTF) CPU Scheduling Simulation
  * Compile: gcc -Wall -o srtf srtf.c
- * Run:     ./srtf
+ * Run:     ./srtf [--stats]
+ *          --stats prints per-phase counters/timing on stderr (perfstats.h)
  *
  * Author: for lab use
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <limits.h>
+#include "perfstats.h"
+
+int main(int argc, char **argv) {
+    struct perf_stats ps;
+    perf_stats_init(&ps, perf_stats_flag(&argc, argv));
+    perf_phase_begin(&ps, "parse");
 
-int main(void) {
     int n, i, completed = 0;
     printf("Enter number of processes: ");
-    if (scanf("%d", &n) != 1 || n <= 0) return 0;
+    if (scanf("%d", &n) != 1 || n <= 0) {
+        perf_stats_report(&ps);
+        return 0;
+    }
 
     int at[n], bt[n], rem[n], ct[n], tat[n], wt[n], pid[n];
     for (i = 0; i < n; ++i) {
@@ -26,7 +36,9 @@ int main(void) {
         rem[i] = bt[i];
         ct[i] = tat[i] = wt[i] = 0;
     }
+    perf_phase_end(&ps);
 
+    perf_phase_begin(&ps, "simulate");
     int time = 0;
     int min_index;
     int found;
@@ -94,7 +106,9 @@ int main(void) {
     }
     avg_tat /= n;
     avg_wt /= n;
+    perf_phase_end(&ps);
 
+    perf_phase_begin(&ps, "output");
     /* Print Gantt chart (compress consecutive same PIDs) */
     printf("\nGantt Chart:\n");
     int idx = 0;
@@ -120,6 +134,8 @@ int main(void) {
 
     printf("\nAverage Turnaround Time = %.2f\n", avg_tat);
     printf("Average Waiting Time    = %.2f\n", avg_wt);
+    perf_phase_end(&ps);
 
+    perf_stats_report(&ps);
     return 0;
 }
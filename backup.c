@@ -0,0 +1,758 @@
+/* backup.c
+ * Incremental version of backup.sh. backup.sh copies every *.txt file into
+ * backup/ on each run and then tars and gzips the whole directory in one
+ * stream. This keeps a manifest of what it copied last time and only
+ * touches files that changed:
+ *
+ *   size and mtime match the manifest     skipped without opening the file
+ *   metadata changed, content hash equal  only the manifest is updated
+ *   otherwise                             copied with a reflink (FICLONE),
+ *                                         or copy_file_range() if the file
+ *                                         system cannot share extents
+ *
+ * Files are hashed and copied by a pool of threads. The archive is a plain
+ * ustar stream cut into chunks; each chunk is compressed on its own core
+ * as an independent gzip member and the members are written in order.
+ * gzip, zcat and tar -xzf read concatenated members as one stream.
+ *
+ * The manifest is backup/.manifest, one line per file:
+ *   <size> <mtime_ns> <hash> <path>
+ *
+ * Compile: gcc -Wall -O2 -pthread -o backup backup.c -lz
+ * Run:     ./backup [-s srcdir] [-d backupdir] [-p pattern] [-j threads]
+ *                   [-c chunk KB] [-F] [-N]
+ *
+ *   -s  directory to walk (default .)
+ *   -d  backup directory (default backup)
+ *   -p  fnmatch() pattern for file names (default *.txt)
+ *   -j  threads for copying and compression (default: online CPUs)
+ *   -c  uncompressed chunk size per gzip member (default 4096 KB)
+ *   -F  archive every file in the manifest, not only the ones copied now
+ *   -N  do not write an archive
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+#define MANIFEST_NAME ".manifest"
+#define IO_BUF        (1 << 20)
+
+enum action { A_UNCHANGED, A_TOUCHED, A_CLONED, A_COPIED, A_FAILED };
+
+struct entry {
+    char *path;                     /* Relative to the source directory */
+    uint64_t size, mtime_ns, hash;
+    enum action action;
+};
+
+struct entry_list {
+    struct entry *v;
+    size_t n, cap;
+};
+
+/* Previous manifest, open addressing on the path */
+struct manifest {
+    struct entry *slot;
+    size_t mask;
+};
+
+static const char *src_dir = ".", *backup_dir = "backup", *pattern = "*.txt";
+static size_t src_len;
+static dev_t backup_dev;
+static ino_t backup_ino;
+static struct entry_list found;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void list_push(struct entry_list *l, struct entry e) {
+    if (l->n == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 256;
+        l->v = realloc(l->v, l->cap * sizeof(*l->v));
+        if (!l->v) {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    l->v[l->n++] = e;
+}
+
+/* ---- Content hash ---- */
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/* 64-bit multiply-rotate hash over 8-byte words; only needs to tell file
+ * versions apart, not resist an adversary */
+static uint64_t hash_update(uint64_t h, const unsigned char *p, size_t len) {
+    const uint64_t k1 = 0x9e3779b185ebca87ull, k2 = 0xc2b2ae3d27d4eb4full;
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = rotl64(h ^ (w * k1), 31) * k2;
+        p += 8;
+        len -= 8;
+    }
+    if (len) {
+        uint64_t w = 0;
+        memcpy(&w, p, len);
+        h = rotl64(h ^ ((w ^ len) * k1), 27) * k2;
+    }
+    return h;
+}
+
+static uint64_t hash_final(uint64_t h, uint64_t size) {
+    h ^= size;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+static int hash_file(const char *path, uint64_t *out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    unsigned char *buf = malloc(IO_BUF);
+    uint64_t h = 0, total = 0;
+    ssize_t n;
+    /* Whole 8-byte words per read keep the result independent of read sizes */
+    size_t carry = 0;
+    while ((n = read(fd, buf + carry, IO_BUF - carry)) > 0) {
+        size_t have = carry + n, whole = have & ~(size_t)7;
+        h = hash_update(h, buf, whole);
+        carry = have - whole;
+        memmove(buf, buf + whole, carry);
+        total += n;
+    }
+    if (n == 0)
+        h = hash_update(h, buf, carry);
+    free(buf);
+    close(fd);
+    if (n < 0)
+        return -1;
+    *out = hash_final(h, total);
+    return 0;
+}
+
+/* ---- Manifest ---- */
+
+static uint64_t hash_path(const char *s) {
+    uint64_t h = 1469598103934665603ull;
+    while (*s)
+        h = (h ^ (unsigned char)*s++) * 1099511628211ull;
+    return h;
+}
+
+static struct entry *manifest_find(const struct manifest *m, const char *path) {
+    if (!m->slot)
+        return NULL;
+    for (size_t i = hash_path(path) & m->mask;; i = (i + 1) & m->mask) {
+        if (!m->slot[i].path)
+            return NULL;
+        if (strcmp(m->slot[i].path, path) == 0)
+            return &m->slot[i];
+    }
+}
+
+static void manifest_load(struct manifest *m, const char *file) {
+    struct entry_list l = { 0 };
+    FILE *fp = fopen(file, "r");
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    memset(m, 0, sizeof(*m));
+    if (!fp)
+        return;
+    while ((len = getline(&line, &cap, fp)) > 0) {
+        struct entry e = { 0 };
+        int off;
+        if (line[len - 1] == '\n')
+            line[len - 1] = '\0';
+        if (sscanf(line, "%lu %lu %lx %n", &e.size, &e.mtime_ns, &e.hash, &off) != 3 || !line[off])
+            continue;
+        e.path = strdup(line + off);
+        list_push(&l, e);
+    }
+    free(line);
+    fclose(fp);
+
+    size_t cap2 = 16;
+    while (cap2 < l.n * 2)
+        cap2 *= 2;
+    m->slot = calloc(cap2, sizeof(*m->slot));
+    m->mask = cap2 - 1;
+    for (size_t i = 0; i < l.n; i++) {
+        size_t j = hash_path(l.v[i].path) & m->mask;
+        while (m->slot[j].path)
+            j = (j + 1) & m->mask;
+        m->slot[j] = l.v[i];
+    }
+    free(l.v);
+}
+
+/* Write to a temporary file and rename, so a crash never leaves half a manifest */
+static int manifest_save(const struct entry_list *l, const char *file) {
+    char tmp[4096 + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp)
+        return -1;
+    for (size_t i = 0; i < l->n; i++) {
+        const struct entry *e = &l->v[i];
+        if (e->action != A_FAILED)
+            fprintf(fp, "%lu %lu %016lx %s\n", e->size, e->mtime_ns, e->hash, e->path);
+    }
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return rename(tmp, file);
+}
+
+/* ---- Walk ---- */
+
+static int walk_cb(const char *path, const struct stat *sb, int type, struct FTW *ftw) {
+    if (type == FTW_D && sb->st_dev == backup_dev && sb->st_ino == backup_ino)
+        return FTW_SKIP_SUBTREE;
+    if (type != FTW_F || !S_ISREG(sb->st_mode))
+        return FTW_CONTINUE;
+    if (fnmatch(pattern, path + ftw->base, 0) != 0)
+        return FTW_CONTINUE;
+
+    const char *rel = path + src_len;
+    while (*rel == '/')
+        rel++;
+    if (strchr(rel, '\n')) {
+        fprintf(stderr, "skipping '%s': newline in name\n", rel);
+        return FTW_CONTINUE;
+    }
+    struct entry e = {
+        .path = strdup(rel),
+        .size = sb->st_size,
+        .mtime_ns = (uint64_t)sb->st_mtim.tv_sec * 1000000000ull + sb->st_mtim.tv_nsec,
+    };
+    list_push(&found, e);
+    return FTW_CONTINUE;
+}
+
+/* ---- Copy ---- */
+
+static int mkdir_parents(char *path) {
+    for (char *p = strchr(path + 1, '/'); p; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        int r = mkdir(path, 0755);
+        *p = '/';
+        if (r < 0 && errno != EEXIST)
+            return -1;
+    }
+    return 0;
+}
+
+/* Share extents if the file system can, else copy in the kernel, else copy
+ * through user space (e.g. across file systems on old kernels) */
+static int copy_file(const char *from, const char *to, uint64_t mtime_ns, int *cloned) {
+    int in = open(from, O_RDONLY), out = -1, ret = -1;
+    struct stat st;
+
+    if (in < 0 || fstat(in, &st) < 0)
+        goto done;
+    out = open(to, O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 0777);
+    if (out < 0)
+        goto done;
+
+    *cloned = ioctl(out, FICLONE, in) == 0;
+    if (!*cloned) {
+        off_t left = st.st_size;
+        while (left > 0) {
+            ssize_t n = copy_file_range(in, NULL, out, NULL, left, 0);
+            if (n <= 0)
+                break;
+            left -= n;
+        }
+        if (left > 0) {
+            char *buf = malloc(IO_BUF);
+            ssize_t n;
+            if (lseek(in, st.st_size - left, SEEK_SET) < 0 || lseek(out, st.st_size - left, SEEK_SET) < 0) {
+                free(buf);
+                goto done;
+            }
+            while ((n = read(in, buf, IO_BUF)) > 0)
+                if (write(out, buf, n) != n)
+                    break;
+            free(buf);
+            if (n != 0)
+                goto done;
+        }
+    }
+
+    /* Keep the source mtime so the copy can be compared by hand */
+    struct timespec ts[2] = { { 0, UTIME_OMIT }, { mtime_ns / 1000000000ull, mtime_ns % 1000000000ull } };
+    futimens(out, ts);
+    ret = 0;
+done:
+    if (in >= 0)
+        close(in);
+    if (out >= 0 && close(out) < 0)
+        ret = -1;
+    return ret;
+}
+
+struct copy_job {
+    struct entry_list *files;
+    const struct manifest *old;
+    size_t next;
+    pthread_mutex_t lock;
+    uint64_t bytes_copied;
+};
+
+static void process_entry(struct entry *e, const struct manifest *old, uint64_t *bytes) {
+    char src[4096], dst[4096];
+    const struct entry *prev = manifest_find(old, e->path);
+    int cloned;
+
+    snprintf(dst, sizeof(dst), "%s/%s", backup_dir, e->path);
+    /* The shortcut only holds while the copy it vouches for is still there */
+    if (prev && prev->size == e->size && prev->mtime_ns == e->mtime_ns && access(dst, F_OK) == 0) {
+        e->hash = prev->hash;
+        e->action = A_UNCHANGED;
+        return;
+    }
+
+    snprintf(src, sizeof(src), "%s/%s", src_dir, e->path);
+    if (hash_file(src, &e->hash) < 0) {
+        fprintf(stderr, "%s: %s\n", src, strerror(errno));
+        e->action = A_FAILED;
+        return;
+    }
+    if (prev && prev->hash == e->hash && access(dst, F_OK) == 0) {
+        e->action = A_TOUCHED;
+        return;
+    }
+    if (mkdir_parents(dst) < 0 || copy_file(src, dst, e->mtime_ns, &cloned) < 0) {
+        fprintf(stderr, "%s -> %s: %s\n", src, dst, strerror(errno));
+        e->action = A_FAILED;
+        return;
+    }
+    e->action = cloned ? A_CLONED : A_COPIED;
+    *bytes += e->size;
+}
+
+static void *copy_worker(void *arg) {
+    struct copy_job *job = arg;
+    uint64_t bytes = 0;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->files->n)
+            break;
+        process_entry(&job->files->v[i], job->old, &bytes);
+    }
+    pthread_mutex_lock(&job->lock);
+    job->bytes_copied += bytes;
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/* ---- Archive: ustar stream -> chunks -> parallel gzip members ---- */
+
+enum chunk_state { C_FREE, C_FILLED, C_BUSY, C_DONE };
+
+struct chunk {
+    enum chunk_state state;
+    long seq;
+    unsigned char *in, *out;
+    size_t in_len, out_len, out_cap;
+};
+
+struct archive {
+    struct chunk *chunks;
+    int nchunks, failed;
+    size_t chunk_size;
+    long produced, written;         /* Chunks handed out / written to disk */
+    int producer_done;
+    FILE *fp;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct chunk *cur;              /* Chunk the producer is filling */
+    uint64_t raw_bytes, gz_bytes;
+};
+
+static int gzip_chunk(struct chunk *c) {
+    z_stream zs = { 0 };
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return -1;
+    size_t need = deflateBound(&zs, c->in_len);
+    if (need > c->out_cap) {
+        free(c->out);
+        c->out = malloc(need);
+        c->out_cap = need;
+    }
+    zs.next_in = c->in;
+    zs.avail_in = c->in_len;
+    zs.next_out = c->out;
+    zs.avail_out = c->out_cap;
+    int r = deflate(&zs, Z_FINISH);
+    c->out_len = c->out_cap - zs.avail_out;
+    deflateEnd(&zs);
+    return r == Z_STREAM_END ? 0 : -1;
+}
+
+static void *gzip_worker(void *arg) {
+    struct archive *ar = arg;
+    pthread_mutex_lock(&ar->lock);
+    for (;;) {
+        struct chunk *c = NULL;
+        for (int i = 0; i < ar->nchunks; i++)
+            if (ar->chunks[i].state == C_FILLED && (!c || ar->chunks[i].seq < c->seq))
+                c = &ar->chunks[i];
+        if (!c) {
+            if (ar->producer_done && ar->written == ar->produced)
+                break;
+            pthread_cond_wait(&ar->cond, &ar->lock);
+            continue;
+        }
+        c->state = C_BUSY;
+        pthread_mutex_unlock(&ar->lock);
+        int r = gzip_chunk(c);
+        pthread_mutex_lock(&ar->lock);
+        if (r < 0)
+            ar->failed = 1;
+        c->state = C_DONE;
+        pthread_cond_broadcast(&ar->cond);
+    }
+    pthread_mutex_unlock(&ar->lock);
+    return NULL;
+}
+
+/* Members must reach the file in stream order, whichever core finished first */
+static void *write_worker(void *arg) {
+    struct archive *ar = arg;
+    pthread_mutex_lock(&ar->lock);
+    for (;;) {
+        struct chunk *c = &ar->chunks[ar->written % ar->nchunks];
+        if (ar->written < ar->produced && c->state == C_DONE) {
+            pthread_mutex_unlock(&ar->lock);
+            int ok = fwrite(c->out, 1, c->out_len, ar->fp) == c->out_len;
+            pthread_mutex_lock(&ar->lock);
+            if (!ok)
+                ar->failed = 1;
+            ar->gz_bytes += c->out_len;
+            c->state = C_FREE;
+            ar->written++;
+            pthread_cond_broadcast(&ar->cond);
+        } else if (ar->producer_done && ar->written == ar->produced) {
+            break;
+        } else {
+            pthread_cond_wait(&ar->cond, &ar->lock);
+        }
+    }
+    pthread_mutex_unlock(&ar->lock);
+    return NULL;
+}
+
+static void archive_submit(struct archive *ar) {
+    pthread_mutex_lock(&ar->lock);
+    ar->cur->state = C_FILLED;
+    ar->produced++;
+    ar->cur = NULL;
+    pthread_cond_broadcast(&ar->cond);
+    pthread_mutex_unlock(&ar->lock);
+}
+
+static void archive_put(struct archive *ar, const void *data, size_t len) {
+    const unsigned char *p = data;
+    ar->raw_bytes += len;
+    while (len > 0) {
+        if (!ar->cur) {
+            pthread_mutex_lock(&ar->lock);
+            struct chunk *c = &ar->chunks[ar->produced % ar->nchunks];
+            while (c->state != C_FREE)
+                pthread_cond_wait(&ar->cond, &ar->lock);
+            c->seq = ar->produced;
+            c->in_len = 0;
+            ar->cur = c;
+            pthread_mutex_unlock(&ar->lock);
+        }
+        size_t n = ar->chunk_size - ar->cur->in_len;
+        if (n > len)
+            n = len;
+        memcpy(ar->cur->in + ar->cur->in_len, p, n);
+        ar->cur->in_len += n;
+        p += n;
+        len -= n;
+        if (ar->cur->in_len == ar->chunk_size)
+            archive_submit(ar);
+    }
+}
+
+static void octal(char *field, size_t width, uint64_t v) {
+    snprintf(field, width, "%0*lo", (int)width - 1, v);
+}
+
+/* ustar header; names over 100 bytes are split into prefix/name at a '/' */
+static int tar_header(unsigned char block[512], const char *name, uint64_t size, mode_t mode, uint64_t mtime) {
+    size_t len = strlen(name);
+    char *h = (char *)block;
+
+    memset(block, 0, 512);
+    if (len <= 100) {
+        memcpy(h, name, len);
+    } else {
+        const char *cut = name + len - 101;
+        while (*cut && *cut != '/')
+            cut++;
+        if (!*cut || cut - name > 155)
+            return -1;
+        memcpy(h + 345, name, cut - name);
+        memcpy(h, cut + 1, len - (cut - name) - 1);
+    }
+    octal(h + 100, 8, mode & 07777);
+    octal(h + 108, 8, 0);
+    octal(h + 116, 8, 0);
+    if (size > 077777777777ull)
+        return -1;
+    octal(h + 124, 12, size);
+    octal(h + 136, 12, mtime);
+    h[156] = '0';
+    memcpy(h + 257, "ustar", 6);
+    memcpy(h + 263, "00", 2);
+    memset(h + 148, ' ', 8);
+    unsigned sum = 0;
+    for (int i = 0; i < 512; i++)
+        sum += block[i];
+    snprintf(h + 148, 8, "%06o", sum);
+    return 0;
+}
+
+static void archive_fail(struct archive *ar) {
+    pthread_mutex_lock(&ar->lock);
+    ar->failed = 1;
+    pthread_mutex_unlock(&ar->lock);
+}
+
+/* A file that cannot be archived in full fails the whole archive */
+static void archive_file(struct archive *ar, const struct entry *e) {
+    static const unsigned char zero[512];
+    unsigned char hdr[512];
+    char path[4096];
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s", backup_dir, e->path);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        archive_fail(ar);
+        return;
+    }
+    if (tar_header(hdr, path, st.st_size, st.st_mode, st.st_mtime) < 0) {
+        fprintf(stderr, "%s: name or size too long for ustar, not archived\n", path);
+        close(fd);
+        archive_fail(ar);
+        return;
+    }
+    archive_put(ar, hdr, sizeof(hdr));
+
+    /* Read straight into the chunk buffers; pad with zeros if the file
+     * shrank so the header stays truthful */
+    uint64_t left = st.st_size;
+    unsigned char buf[64 * 1024];
+    while (left > 0) {
+        ssize_t n = read(fd, buf, left < sizeof(buf) ? left : sizeof(buf));
+        if (n <= 0) {
+            if (n < 0) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                archive_fail(ar);
+            }
+            while (left > 0) {
+                size_t z = left < sizeof(zero) ? left : sizeof(zero);
+                archive_put(ar, zero, z);
+                left -= z;
+            }
+            break;
+        }
+        archive_put(ar, buf, n);
+        left -= n;
+    }
+    close(fd);
+    if (st.st_size % 512)
+        archive_put(ar, zero, 512 - st.st_size % 512);
+}
+
+static int write_archive(const char *file, const struct entry_list *files, int full, int threads,
+                         size_t chunk_size, uint64_t *raw, uint64_t *gz, long *members) {
+    static const unsigned char zero[1024];
+    struct archive ar = { 0 };
+    pthread_t writer, *workers = malloc(threads * sizeof(pthread_t));
+
+    ar.fp = fopen(file, "wb");
+    if (!ar.fp)
+        return -1;
+    ar.chunk_size = chunk_size;
+    ar.nchunks = 2 * threads;
+    ar.chunks = calloc(ar.nchunks, sizeof(*ar.chunks));
+    for (int i = 0; i < ar.nchunks; i++)
+        ar.chunks[i].in = malloc(chunk_size);
+    pthread_mutex_init(&ar.lock, NULL);
+    pthread_cond_init(&ar.cond, NULL);
+    for (int i = 0; i < threads; i++)
+        pthread_create(&workers[i], NULL, gzip_worker, &ar);
+    pthread_create(&writer, NULL, write_worker, &ar);
+
+    for (size_t i = 0; i < files->n; i++) {
+        const struct entry *e = &files->v[i];
+        if (e->action == A_FAILED || (!full && e->action != A_CLONED && e->action != A_COPIED))
+            continue;
+        archive_file(&ar, e);
+    }
+    archive_put(&ar, zero, sizeof(zero));
+    if (ar.cur)
+        archive_submit(&ar);
+
+    pthread_mutex_lock(&ar.lock);
+    ar.producer_done = 1;
+    pthread_cond_broadcast(&ar.cond);
+    pthread_mutex_unlock(&ar.lock);
+    pthread_join(writer, NULL);
+    for (int i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+
+    if (fclose(ar.fp) != 0)
+        ar.failed = 1;
+    for (int i = 0; i < ar.nchunks; i++) {
+        free(ar.chunks[i].in);
+        free(ar.chunks[i].out);
+    }
+    free(ar.chunks);
+    free(workers);
+    *raw = ar.raw_bytes;
+    *gz = ar.gz_bytes;
+    *members = ar.produced;
+    return ar.failed ? -1 : 0;
+}
+
+static int cmp_path(const void *a, const void *b) {
+    return strcmp(((const struct entry *)a)->path, ((const struct entry *)b)->path);
+}
+
+int main(int argc, char **argv) {
+    int threads = sysconf(_SC_NPROCESSORS_ONLN), full = 0, no_archive = 0, opt;
+    size_t chunk_size = 4096 << 10;
+
+    while ((opt = getopt(argc, argv, "s:d:p:j:c:FN")) != -1) {
+        switch (opt) {
+        case 's': src_dir = optarg; break;
+        case 'd': backup_dir = optarg; break;
+        case 'p': pattern = optarg; break;
+        case 'j': threads = atoi(optarg); break;
+        case 'c': chunk_size = (size_t)atol(optarg) << 10; break;
+        case 'F': full = 1; break;
+        case 'N': no_archive = 1; break;
+        default:  return EXIT_FAILURE;
+        }
+    }
+    if (threads <= 0 || chunk_size == 0) {
+        fprintf(stderr, "Invalid arguments.\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Step 1: Create the backup directory if it doesn't exist */
+    struct stat st;
+    if (mkdir(backup_dir, 0755) < 0 && errno != EEXIST) {
+        perror(backup_dir);
+        return EXIT_FAILURE;
+    }
+    if (stat(backup_dir, &st) < 0) {
+        perror(backup_dir);
+        return EXIT_FAILURE;
+    }
+    backup_dev = st.st_dev;
+    backup_ino = st.st_ino;
+
+    char manifest_file[4096];
+    struct manifest old;
+    snprintf(manifest_file, sizeof(manifest_file), "%s/%s", backup_dir, MANIFEST_NAME);
+    manifest_load(&old, manifest_file);
+
+    /* Step 2: Find the files, skipping the backup directory itself */
+    double t0 = now_sec();
+    src_len = strlen(src_dir);
+    if (nftw(src_dir, walk_cb, 64, FTW_PHYS | FTW_ACTIONRETVAL) < 0) {
+        perror(src_dir);
+        return EXIT_FAILURE;
+    }
+    qsort(found.v, found.n, sizeof(*found.v), cmp_path);
+    double t_walk = now_sec() - t0;
+
+    /* Step 3: Hash and copy whatever changed */
+    struct copy_job job = { .files = &found, .old = &old };
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    pthread_mutex_init(&job.lock, NULL);
+    for (int i = 0; i < threads; i++)
+        pthread_create(&tids[i], NULL, copy_worker, &job);
+    for (int i = 0; i < threads; i++)
+        pthread_join(tids[i], NULL);
+    free(tids);
+    double t_copy = now_sec() - t0 - t_walk;
+
+    long count[A_FAILED + 1] = { 0 };
+    for (size_t i = 0; i < found.n; i++)
+        count[found.v[i].action]++;
+    if (manifest_save(&found, manifest_file) < 0)
+        fprintf(stderr, "%s: %s\n", manifest_file, strerror(errno));
+
+    printf("%zu files matched '%s' in %.3f s\n", found.n, pattern, t_walk);
+    printf("  unchanged %ld, metadata only %ld, reflinked %ld, copied %ld, failed %ld\n",
+           count[A_UNCHANGED], count[A_TOUCHED], count[A_CLONED], count[A_COPIED], count[A_FAILED]);
+    printf("  %.1f MB copied in %.3f s\n", job.bytes_copied / 1048576.0, t_copy);
+
+    /* Step 4: Compress into a tar.gz archive */
+    if (!no_archive) {
+        if (!full && count[A_CLONED] + count[A_COPIED] == 0) {
+            printf("Nothing changed, no archive written (-F for a full one)\n");
+        } else {
+            char archive_name[64];
+            time_t now = time(NULL);
+            strftime(archive_name, sizeof(archive_name), "backup_%Y%m%d_%H%M%S.tar.gz", localtime(&now));
+            uint64_t raw, gz;
+            long members;
+            double ta = now_sec();
+            if (write_archive(archive_name, &found, full, threads, chunk_size, &raw, &gz, &members) < 0) {
+                fprintf(stderr, "%s: archive failed, removed\n", archive_name);
+                unlink(archive_name);
+                return EXIT_FAILURE;
+            }
+            double t_arch = now_sec() - ta;
+            printf("  %s archive '%s': %.1f MB -> %.1f MB in %ld gzip members, %.3f s (%.0f MB/s, %d threads)\n",
+                   full ? "full" : "incremental", archive_name, raw / 1048576.0, gz / 1048576.0,
+                   members, t_arch, raw / 1048576.0 / t_arch, threads);
+        }
+    }
+
+    /* Step 5: Print success message */
+    printf("Backup complete!\n");
+    return count[A_FAILED] ? EXIT_FAILURE : EXIT_SUCCESS;
+}
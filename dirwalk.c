@@ -0,0 +1,345 @@
+/* dirwalk.c
+ * Directory listing and recursive walk for filemanage.sh's "List Files and
+ * Directories" option. ls -l sorts, stats every entry for every field and
+ * formats with locale lookups; find walks one directory at a time. This
+ * reads directories with getdents64() into a large buffer, calls statx()
+ * only when a field is actually needed (and asks only for those fields),
+ * and with -r walks subdirectories in parallel from a shared work queue.
+ *
+ * Output is streamed as each directory is read, in whole lines, unless
+ * -s asks for it sorted by path.
+ *
+ * Compile: gcc -Wall -O2 -pthread -o dirwalk dirwalk.c
+ * Run:     ./dirwalk [-r] [-l] [-s] [-c] [-j threads] [-p pattern] [-t f|d|l] [dir...]
+ *
+ *   -r  recurse into subdirectories (like find)
+ *   -l  long format: mode, size, mtime (statx with just those fields)
+ *   -s  sort the output by path
+ *   -c  only print counts and the time taken
+ *   -j  threads for -r (default: online CPUs)
+ *   -p  only print names matching the fnmatch() pattern
+ *   -t  only print regular files, directories or symlinks
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#define DENTS_BUF (1 << 20)             /* getdents64 buffer per thread */
+#define OUT_BUF   (64 * 1024)           /* Output buffer per thread */
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Directories still to read; a LIFO keeps the walk close to depth-first,
+ * so the queue stays small on wide trees */
+struct work_queue {
+    char **dirs;
+    size_t n, cap;
+    int active;                         /* Threads currently reading a directory */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+struct walker {
+    char *dents;
+    char out[OUT_BUF];
+    size_t out_len;
+    char **lines;                       /* -s: everything printed, sorted at the end */
+    size_t nlines, lines_cap;
+    unsigned long entries, dirs;
+};
+
+static int recursive, long_format, sorted, count_only;
+static const char *pattern;
+static int type_filter = -1;            /* DT_REG, DT_DIR or DT_LNK */
+static struct work_queue queue = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void queue_push(char *dir) {
+    pthread_mutex_lock(&queue.lock);
+    if (queue.n == queue.cap) {
+        queue.cap = queue.cap ? queue.cap * 2 : 1024;
+        queue.dirs = realloc(queue.dirs, queue.cap * sizeof(char *));
+    }
+    queue.dirs[queue.n++] = dir;
+    pthread_cond_signal(&queue.cond);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+/* NULL once the queue is empty and nobody is left to add to it */
+static char *queue_pop(void) {
+    pthread_mutex_lock(&queue.lock);
+    while (queue.n == 0 && queue.active > 0)
+        pthread_cond_wait(&queue.cond, &queue.lock);
+    char *dir = NULL;
+    if (queue.n > 0) {
+        dir = queue.dirs[--queue.n];
+        queue.active++;
+    } else {
+        pthread_cond_broadcast(&queue.cond);
+    }
+    pthread_mutex_unlock(&queue.lock);
+    return dir;
+}
+
+static void queue_done(void) {
+    pthread_mutex_lock(&queue.lock);
+    if (--queue.active == 0 && queue.n == 0)
+        pthread_cond_broadcast(&queue.cond);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+static void out_flush(struct walker *w) {
+    if (!w->out_len)
+        return;
+    pthread_mutex_lock(&out_lock);
+    for (size_t off = 0; off < w->out_len; ) {
+        ssize_t n = write(STDOUT_FILENO, w->out + off, w->out_len - off);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        off += n;
+    }
+    pthread_mutex_unlock(&out_lock);
+    w->out_len = 0;
+}
+
+static void out_line(struct walker *w, const char *line, size_t len) {
+    if (sorted) {
+        if (w->nlines == w->lines_cap) {
+            w->lines_cap = w->lines_cap ? w->lines_cap * 2 : 4096;
+            w->lines = realloc(w->lines, w->lines_cap * sizeof(char *));
+        }
+        w->lines[w->nlines++] = strndup(line, len);
+        return;
+    }
+    if (w->out_len + len > OUT_BUF)
+        out_flush(w);
+    memcpy(w->out + w->out_len, line, len);
+    w->out_len += len;
+}
+
+static void mode_string(char *s, unsigned mode) {
+    static const char types[] = "?pc?d?b?-?l?s???";
+    s[0] = types[(mode >> 12) & 15];
+    for (int i = 0; i < 9; i++)
+        s[1 + i] = (mode & (0400 >> i)) ? "rwxrwxrwx"[i] : '-';
+    s[10] = '\0';
+}
+
+static unsigned char type_from_mode(unsigned mode) {
+    return S_ISDIR(mode) ? DT_DIR : S_ISREG(mode) ? DT_REG : S_ISLNK(mode) ? DT_LNK : DT_UNKNOWN;
+}
+
+/* Read one directory; subdirectories go back on the queue when recursing */
+static void walk_dir(struct walker *w, const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "dirwalk: %s: %s\n", dir, strerror(errno));
+        return;
+    }
+    w->dirs++;
+    size_t dlen = strlen(dir);
+    int slash = dlen > 0 && dir[dlen - 1] != '/';
+    long n;
+
+    while ((n = syscall(SYS_getdents64, fd, w->dents, DENTS_BUF)) > 0) {
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(w->dents + off);
+            off += d->d_reclen;
+            const char *name = d->d_name;
+            if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+                continue;
+            w->entries++;
+
+            unsigned char type = d->d_type;
+            struct statx stx;
+            int have_stx = 0;
+            /* Only stat when the listing needs it or the file system did
+             * not fill in d_type */
+            if (long_format || type == DT_UNKNOWN) {
+                unsigned mask = long_format ? STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME : STATX_TYPE;
+                if (statx(fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask, &stx) == 0) {
+                    have_stx = 1;
+                    type = type_from_mode(stx.stx_mode);
+                }
+            }
+
+            size_t nlen = strlen(name);
+            if (recursive && type == DT_DIR) {
+                char *sub = malloc(dlen + nlen + 2);
+                memcpy(sub, dir, dlen);
+                if (slash)
+                    sub[dlen] = '/';
+                memcpy(sub + dlen + slash, name, nlen + 1);
+                queue_push(sub);
+            }
+
+            if (count_only || (type_filter >= 0 && type != type_filter) ||
+                (pattern && fnmatch(pattern, name, 0) != 0))
+                continue;
+
+            char line[8192];
+            int len = 0;
+            if (long_format) {
+                char mode[11] = "??????????", when[32] = "? ?";
+                unsigned long long size = 0;
+                if (have_stx) {
+                    time_t t = stx.stx_mtime.tv_sec;
+                    struct tm tm;
+                    mode_string(mode, stx.stx_mode);
+                    size = stx.stx_size;
+                    strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime_r(&t, &tm));
+                }
+                len = snprintf(line, sizeof(line), "%s %12llu %s ", mode, size, when);
+            }
+            if (recursive)
+                len += snprintf(line + len, sizeof(line) - len, "%s%s", dir, slash ? "/" : "");
+            len += snprintf(line + len, sizeof(line) - len, "%s\n", name);
+            if (len >= (int)sizeof(line))
+                len = sizeof(line) - 1;
+            out_line(w, line, len);
+        }
+    }
+    if (n < 0)
+        fprintf(stderr, "dirwalk: %s: %s\n", dir, strerror(errno));
+    close(fd);
+}
+
+static void *walk_thread(void *arg) {
+    struct walker *w = arg;
+    char *dir;
+    while ((dir = queue_pop()) != NULL) {
+        walk_dir(w, dir);
+        free(dir);
+        queue_done();
+        /* Stream per directory so output keeps up with a long walk */
+        out_flush(w);
+    }
+    return NULL;
+}
+
+/* Skip the mode, size, date and time fields of a -l line. Every row has
+ * all four (placeholders when statx fails); stop at the end regardless */
+static const char *path_field(const char *s) {
+    for (int i = 0; i < 4; i++) {
+        const char *sp = strchr(s, ' ');
+        if (!sp)
+            break;
+        s = sp;
+        while (*s == ' ') s++;
+    }
+    return s;
+}
+
+/* Sort on the path, which is the last field in every format */
+static int cmp_line(const void *a, const void *b) {
+    const char *x = *(char *const *)a, *y = *(char *const *)b;
+    if (long_format) {
+        x = path_field(x);
+        y = path_field(y);
+    }
+    return strcmp(x, y);
+}
+
+int main(int argc, char **argv) {
+    int threads = sysconf(_SC_NPROCESSORS_ONLN), opt;
+
+    while ((opt = getopt(argc, argv, "rlscj:p:t:")) != -1) {
+        switch (opt) {
+        case 'r': recursive = 1; break;
+        case 'l': long_format = 1; break;
+        case 's': sorted = 1; break;
+        case 'c': count_only = 1; break;
+        case 'j': threads = atoi(optarg); break;
+        case 'p': pattern = optarg; break;
+        case 't':
+            type_filter = optarg[0] == 'f' ? DT_REG : optarg[0] == 'd' ? DT_DIR :
+                          optarg[0] == 'l' ? DT_LNK : -2;
+            break;
+        default:  return EXIT_FAILURE;
+        }
+    }
+    if (threads <= 0 || type_filter == -2) {
+        fprintf(stderr, "Invalid arguments.\n");
+        return EXIT_FAILURE;
+    }
+    if (!recursive)
+        threads = 1;
+
+    if (optind == argc)
+        queue_push(strdup("."));
+    for (int i = optind; i < argc; i++)
+        queue_push(strdup(argv[i]));
+
+    double start = now_sec();
+    struct walker *w = calloc(threads, sizeof(*w));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    for (int i = 0; i < threads; i++) {
+        w[i].dents = malloc(DENTS_BUF);
+        pthread_create(&tids[i], NULL, walk_thread, &w[i]);
+    }
+    for (int i = 0; i < threads; i++)
+        pthread_join(tids[i], NULL);
+
+    unsigned long entries = 0, dirs = 0;
+    size_t total_lines = 0;
+    for (int i = 0; i < threads; i++) {
+        entries += w[i].entries;
+        dirs += w[i].dirs;
+        total_lines += w[i].nlines;
+    }
+
+    if (sorted) {
+        char **all = malloc((total_lines ? total_lines : 1) * sizeof(char *));
+        size_t k = 0;
+        for (int i = 0; i < threads; i++) {
+            memcpy(all + k, w[i].lines, w[i].nlines * sizeof(char *));
+            k += w[i].nlines;
+            free(w[i].lines);
+        }
+        qsort(all, k, sizeof(char *), cmp_line);
+        sorted = 0;
+        for (size_t i = 0; i < k; i++) {
+            out_line(&w[0], all[i], strlen(all[i]));
+            free(all[i]);
+        }
+        out_flush(&w[0]);
+        free(all);
+    }
+
+    if (count_only)
+        printf("%lu entries in %lu directories, %.3f s, %d threads\n",
+               entries, dirs, now_sec() - start, threads);
+    for (int i = 0; i < threads; i++)
+        free(w[i].dents);
+    free(w);
+    free(tids);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#!/bin/bash
+# Compare dirwalk with ls -l and find on a generated tree
+# Usage: ./dirwalk_bench.sh [files] [subdirs]
+
+FILES=${1:-200000}
+SUBDIRS=${2:-100}
+TREE=$(mktemp -d /tmp/dirwalk_bench.XXXXXX)
+trap 'rm -rf "$TREE"' EXIT
+
+# Step 1: Build dirwalk if needed
+if [ ! -x ./dirwalk ] || [ dirwalk.c -nt ./dirwalk ]; then
+    gcc -Wall -O2 -pthread -o dirwalk dirwalk.c || exit 1
+fi
+
+# Step 2: One flat directory for the listing, a nested tree for the walk
+echo "Creating $FILES files flat and $FILES files in $SUBDIRS subdirectories under $TREE ..."
+mkdir -p "$TREE/flat" "$TREE/tree"
+(cd "$TREE/flat" && seq -f "file%.0f.txt" 1 "$FILES" | xargs touch)
+for (( d=0; d<SUBDIRS; d++ ))
+do
+    mkdir -p "$TREE/tree/d$d/sub"
+done
+(cd "$TREE/tree" && seq 1 "$FILES" | awk -v n="$SUBDIRS" '{ printf "d%d/%s/f%d.%s\n", $1 % n, ($1 % 2 ? "sub" : "."), $1, ($1 % 3 ? "txt" : "log") }' | xargs touch)
+
+# Step 3: Time each command with a warm cache, best of three
+run() {
+    local label=$1 best=""
+    shift
+    "$@" > /dev/null 2>&1
+    for i in 1 2 3
+    do
+        local start=$(date +%s%N)
+        "$@" > /dev/null 2>&1
+        local ms=$(( ($(date +%s%N) - start) / 1000000 ))
+        if [ -z "$best" ] || [ "$ms" -lt "$best" ]; then
+            best=$ms
+        fi
+    done
+    printf "  %-34s %6d ms\n" "$label" "$best"
+}
+
+echo "Listing one directory of $FILES entries:"
+run "ls -l"                     ls -l "$TREE/flat"
+run "ls -f (unsorted names)"    ls -f "$TREE/flat"
+run "dirwalk -l -s"             ./dirwalk -l -s "$TREE/flat"
+run "dirwalk -l"                ./dirwalk -l "$TREE/flat"
+run "dirwalk"                   ./dirwalk "$TREE/flat"
+
+echo "Recursive walk of $FILES entries in $((SUBDIRS * 2)) directories:"
+run "find"                      find "$TREE/tree"
+run "dirwalk -r"                ./dirwalk -r "$TREE/tree"
+run "dirwalk -r -j 1"           ./dirwalk -r -j 1 "$TREE/tree"
+run "find -name '*.txt'"        find "$TREE/tree" -name '*.txt'
+run "dirwalk -r -p '*.txt'"     ./dirwalk -r -p '*.txt' "$TREE/tree"
+run "find -ls"                  find "$TREE/tree" -ls
+run "dirwalk -r -l"             ./dirwalk -r -l "$TREE/tree"
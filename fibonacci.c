@@ -0,0 +1,397 @@
+/* fibonacci.c
+ * Native version of fibonacci.sh. The script adds in bash's 64-bit
+ * integers, so every term after F(92) is silently wrong. Here numbers are
+ * arbitrary precision, stored as little-endian limbs in base 10^9, so
+ * printing is a straight copy of 9 digits per limb with no radix
+ * conversion, and costs no more than writing the output.
+ *
+ * F(n) uses fast doubling, O(log n) steps with two multiplications each:
+ *   F(2k)   = F(k)   * (2 F(k+1) - F(k))
+ *   F(2k+2) = F(k+1) * (2 F(k) + F(k+1))
+ *   F(2k+1) = F(2k+2) - F(2k)
+ * Multiplication is Karatsuba above KARATSUBA_MIN limbs and schoolbook
+ * below, with carries deferred so the inner loop is a plain multiply-add.
+ *
+ * Compile: gcc -Wall -O2 -o fibonacci fibonacci.c
+ * Run:     ./fibonacci                 first 10 terms, like fibonacci.sh
+ *          ./fibonacci -t N            first N terms, streamed
+ *          ./fibonacci -n N [-q]       F(N); -q prints only its size, the
+ *                                      leading/trailing digits and timings
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BASE          1000000000u
+#define BASE_DIGITS   9
+#define KARATSUBA_MIN 40               /* Limbs; below this schoolbook wins */
+#define DEFER_ROWS    16               /* 16 * (10^9)^2 + 10^9 < 2^64 */
+#define OUT_BUF       (1 << 20)
+
+typedef uint32_t limb;
+
+struct bigint {
+    limb *d;
+    size_t n, cap;                      /* n == 0 means zero */
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *xmalloc(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void big_reserve(struct bigint *x, size_t cap) {
+    if (cap > x->cap) {
+        x->cap = cap + cap / 4;
+        x->d = realloc(x->d, x->cap * sizeof(limb));
+        if (!x->d) {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static size_t trim(const limb *a, size_t n) {
+    while (n && !a[n - 1])
+        n--;
+    return n;
+}
+
+/* ---- Limb array primitives ---- */
+
+/* r = a + b; r needs max(na, nb) + 1 limbs and may alias a or b */
+static size_t add_limbs(limb *r, const limb *a, size_t na, const limb *b, size_t nb) {
+    if (na < nb) {
+        const limb *t = a; a = b; b = t;
+        size_t tn = na; na = nb; nb = tn;
+    }
+    limb carry = 0;
+    size_t i;
+    for (i = 0; i < nb; i++) {
+        limb s = a[i] + b[i] + carry;
+        carry = s >= BASE;
+        r[i] = carry ? s - BASE : s;
+    }
+    for (; i < na; i++) {
+        limb s = a[i] + carry;
+        carry = s >= BASE;
+        r[i] = carry ? s - BASE : s;
+    }
+    r[na] = carry;
+    return na + carry;
+}
+
+/* a -= b in place; a >= b */
+static void sub_limbs(limb *a, size_t na, const limb *b, size_t nb) {
+    limb borrow = 0;
+    size_t i;
+    for (i = 0; i < nb; i++) {
+        limb s = b[i] + borrow;
+        borrow = a[i] < s;
+        a[i] = borrow ? a[i] + BASE - s : a[i] - s;
+    }
+    for (; borrow && i < na; i++) {
+        borrow = a[i] == 0;
+        a[i] = borrow ? BASE - 1 : a[i] - 1;
+    }
+}
+
+/* r += a, carry running up through r's rn limbs */
+static void add_into(limb *r, size_t rn, const limb *a, size_t na) {
+    limb carry = 0;
+    size_t i;
+    for (i = 0; i < na; i++) {
+        limb s = r[i] + a[i] + carry;
+        carry = s >= BASE;
+        r[i] = carry ? s - BASE : s;
+    }
+    for (; carry && i < rn; i++) {
+        limb s = r[i] + 1;
+        carry = s >= BASE;
+        r[i] = carry ? 0 : s;
+    }
+}
+
+/* r = a * b with nb small: rows of b are accumulated into 64-bit columns
+ * and carries are pushed only every DEFER_ROWS rows */
+static void mul_school(limb *r, const limb *a, size_t na, const limb *b, size_t nb) {
+    uint64_t stack_acc[4 * KARATSUBA_MIN], *acc = stack_acc;
+    size_t nr = na + nb;
+    if (nr > sizeof(stack_acc) / sizeof(stack_acc[0]))
+        acc = xmalloc(nr * sizeof(uint64_t));
+    memset(acc, 0, nr * sizeof(uint64_t));
+
+    for (size_t i = 0; i < nb; i++) {
+        uint64_t bi = b[i], *row = acc + i;
+        for (size_t j = 0; j < na; j++)
+            row[j] += bi * a[j];
+        if ((i + 1) % DEFER_ROWS == 0 || i + 1 == nb) {
+            uint64_t carry = 0;
+            for (size_t k = 0; k < nr; k++) {
+                uint64_t t = acc[k] + carry;
+                acc[k] = t % BASE;
+                carry = t / BASE;
+            }
+        }
+    }
+    for (size_t k = 0; k < nr; k++)
+        r[k] = (limb)acc[k];
+    if (acc != stack_acc)
+        free(acc);
+}
+
+/* r = a * b, r has na + nb limbs and does not overlap a or b */
+static void mul_limbs(limb *r, const limb *a, size_t na, const limb *b, size_t nb) {
+    if (na < nb) {
+        const limb *t = a; a = b; b = t;
+        size_t tn = na; na = nb; nb = tn;
+    }
+    if (nb < KARATSUBA_MIN) {
+        mul_school(r, a, na, b, nb);
+        return;
+    }
+
+    /* Lopsided: cut a into nb-sized pieces and multiply each by b */
+    if (2 * nb <= na) {
+        limb *t = xmalloc(2 * nb * sizeof(limb));
+        memset(r, 0, (na + nb) * sizeof(limb));
+        for (size_t off = 0; off < na; off += nb) {
+            size_t len = na - off < nb ? na - off : nb;
+            mul_limbs(t, a + off, len, b, nb);
+            add_into(r + off, na + nb - off, t, len + nb);
+        }
+        free(t);
+        return;
+    }
+
+    /* a = a1 B^m + a0, b = b1 B^m + b0; z0 and z2 go straight into r */
+    size_t m = na / 2, n1 = na - m, m1 = nb - m;
+    mul_limbs(r, a, m, b, m);
+    mul_limbs(r + 2 * m, a + m, n1, b + m, m1);
+
+    limb *sa = xmalloc((n1 + 1) * sizeof(limb));
+    limb *sb = xmalloc((n1 + 1) * sizeof(limb));
+    size_t la = add_limbs(sa, a, m, a + m, n1);
+    size_t lb = add_limbs(sb, b, m, b + m, m1);
+    limb *z1 = xmalloc((la + lb) * sizeof(limb));
+    mul_limbs(z1, sa, la, sb, lb);
+    sub_limbs(z1, la + lb, r, 2 * m);
+    sub_limbs(z1, la + lb, r + 2 * m, n1 + m1);
+    add_into(r + m, na + nb - m, z1, trim(z1, la + lb));
+    free(sa);
+    free(sb);
+    free(z1);
+}
+
+/* ---- bigint wrappers ---- */
+
+static void big_set(struct bigint *x, limb v) {
+    big_reserve(x, 1);
+    x->d[0] = v;
+    x->n = v != 0;
+}
+
+static void big_add(struct bigint *r, const struct bigint *a, const struct bigint *b) {
+    big_reserve(r, (a->n > b->n ? a->n : b->n) + 1);
+    r->n = add_limbs(r->d, a->d, a->n, b->d, b->n);
+}
+
+/* r = 2a + b */
+static void big_twice_plus(struct bigint *r, const struct bigint *a, const struct bigint *b) {
+    big_add(r, a, a);
+    big_reserve(r, (r->n > b->n ? r->n : b->n) + 1);
+    r->n = add_limbs(r->d, r->d, r->n, b->d, b->n);
+}
+
+/* a -= b; a >= b */
+static void big_sub(struct bigint *a, const struct bigint *b) {
+    sub_limbs(a->d, a->n, b->d, b->n);
+    a->n = trim(a->d, a->n);
+}
+
+static void big_mul(struct bigint *r, const struct bigint *a, const struct bigint *b) {
+    if (!a->n || !b->n) {
+        r->n = 0;
+        return;
+    }
+    big_reserve(r, a->n + b->n);
+    mul_limbs(r->d, a->d, a->n, b->d, b->n);
+    r->n = trim(r->d, a->n + b->n);
+}
+
+static void big_swap(struct bigint *a, struct bigint *b) {
+    struct bigint t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/* ---- Output ---- */
+
+static char out_buf[OUT_BUF];
+static size_t out_len;
+
+static void out_flush(void) {
+    fwrite(out_buf, 1, out_len, stdout);
+    out_len = 0;
+}
+
+static void out_bytes(const char *s, size_t n) {
+    while (n > 0) {
+        if (out_len == OUT_BUF)
+            out_flush();
+        size_t k = OUT_BUF - out_len < n ? OUT_BUF - out_len : n;
+        memcpy(out_buf + out_len, s, k);
+        out_len += k;
+        s += k;
+        n -= k;
+    }
+}
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* One limb as exactly 9 digits, two at a time */
+static void limb_digits(char *s, limb v) {
+    s[8] = '0' + v % 10;
+    v /= 10;
+    for (int i = 6; i >= 0; i -= 2) {
+        memcpy(s + i, digit_pairs + 2 * (v % 100), 2);
+        v /= 100;
+    }
+}
+
+/* Decimal text of x into s (at least n * 9 + 1 bytes), NUL-terminated;
+ * returns the length */
+static size_t big_format(char *s, const struct bigint *x) {
+    if (!x->n) {
+        strcpy(s, "0");
+        return 1;
+    }
+    size_t len = sprintf(s, "%u", x->d[x->n - 1]);
+    for (size_t i = x->n - 1; i-- > 0; len += BASE_DIGITS)
+        limb_digits(s + len, x->d[i]);
+    s[len] = '\0';
+    return len;
+}
+
+/* ---- Fibonacci ---- */
+
+static void fib(unsigned long n, struct bigint *result) {
+    struct bigint a = { 0 }, b = { 0 }, c = { 0 }, d = { 0 }, t = { 0 };
+    int top = n ? 63 - __builtin_clzl(n) : -1;
+
+    big_set(&a, 0);                     /* F(k), k = 0 */
+    big_set(&b, 1);                     /* F(k+1) */
+    for (int bit = top; bit >= 0; bit--) {
+        big_add(&t, &b, &b);            /* 2 F(k+1) - F(k) */
+        big_sub(&t, &a);
+        big_mul(&c, &a, &t);            /* F(2k) */
+        big_twice_plus(&t, &a, &b);
+        big_mul(&d, &b, &t);            /* F(2k+2) */
+        big_sub(&d, &c);                /* F(2k+1) */
+        if ((n >> bit) & 1) {
+            big_add(&t, &c, &d);        /* F(2k+2) */
+            big_swap(&a, &d);
+            big_swap(&b, &t);
+        } else {
+            big_swap(&a, &c);
+            big_swap(&b, &d);
+        }
+    }
+    free(result->d);
+    *result = a;
+    free(b.d);
+    free(c.d);
+    free(d.d);
+    free(t.d);
+}
+
+/* First `terms` numbers, each printed straight from its limbs */
+static void stream_terms(unsigned long terms) {
+    struct bigint a = { 0 }, b = { 0 };
+    char *text = NULL;
+    size_t text_cap = 0;
+
+    big_set(&a, 0);
+    big_set(&b, 1);
+    printf("Fibonacci sequence up to %lu terms:\n", terms);
+    for (unsigned long i = 0; i < terms; i++) {
+        size_t need = a.n * BASE_DIGITS + 2;
+        if (need > text_cap) {
+            text_cap = 2 * need;
+            free(text);
+            text = xmalloc(text_cap);
+        }
+        size_t len = big_format(text, &a);
+        text[len++] = ' ';
+        out_bytes(text, len);
+        /* a, b = b, a + b without allocating */
+        big_add(&a, &a, &b);
+        big_swap(&a, &b);
+    }
+    out_flush();
+    putchar('\n');
+    free(text);
+    free(a.d);
+    free(b.d);
+}
+
+int main(int argc, char **argv) {
+    unsigned long n = 0, terms = 10;
+    int single = 0, quiet = 0, opt;
+
+    while ((opt = getopt(argc, argv, "n:t:q")) != -1) {
+        switch (opt) {
+        case 'n': n = strtoul(optarg, NULL, 10); single = 1; break;
+        case 't': terms = strtoul(optarg, NULL, 10); break;
+        case 'q': quiet = 1; break;
+        default:  return EXIT_FAILURE;
+        }
+    }
+
+    if (!single) {
+        stream_terms(terms);
+        return EXIT_SUCCESS;
+    }
+
+    struct bigint f = { 0 };
+    double t0 = now_sec();
+    fib(n, &f);
+    double t1 = now_sec();
+    char *text = xmalloc(f.n * BASE_DIGITS + 2);
+    size_t len = big_format(text, &f);
+    double t2 = now_sec();
+
+    if (quiet) {
+        printf("F(%lu) has %zu digits\n", n, len);
+        if (len > 40)
+            printf("  %.20s...%s\n", text, text + len - 20);
+        else
+            printf("  %s\n", text);
+        printf("  computed in %.3f s, formatted in %.3f s\n", t1 - t0, t2 - t1);
+    } else {
+        text[len++] = '\n';
+        out_bytes(text, len);
+        out_flush();
+    }
+    free(text);
+    free(f.d);
+    return EXIT_SUCCESS;
+}
@@ -61,7 +61,12 @@ do
             ;;
         6)
             echo "Listing files and directories in current location:"
-            ls -l
+            # dirwalk (dirwalk.c) lists large directories much faster than ls
+            if [ -x ./dirwalk ]; then
+                ./dirwalk -l -s
+            else
+                ls -l
+            fi
             ;;
         7)
             echo "Exiting..."
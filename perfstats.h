@@ -0,0 +1,220 @@
+/* perfstats.h
+ * Per-phase hardware counters and wall-clock time for the simulators
+ * (FIFO.c, LRU.c, SRTF.c, BANKER.c), enabled with --stats and reported on
+ * stderr so the normal output is unchanged.
+ *
+ * Counters are one perf_event_open() group, so they are scheduled onto the
+ * PMU together and their ratios (IPC, misses per instruction) are
+ * consistent: cycles (group leader), instructions, cache misses and branch
+ * misses, user space only so perf_event_paranoid <= 2 suffices. A counter
+ * the CPU does not have is left out; if the group cannot be opened at all
+ * (no PMU in a VM, paranoid level, seccomp) only time is reported.
+ *
+ * Usage:
+ *   #define _GNU_SOURCE            (before any #include)
+ *   #include "perfstats.h"
+ *
+ *   struct perf_stats ps;
+ *   perf_stats_init(&ps, perf_stats_flag(&argc, argv));
+ *   perf_phase_begin(&ps, "parse");   ...   perf_phase_end(&ps);
+ *   perf_stats_report(&ps);
+ *
+ * Every exit after perf_stats_init() should go through perf_stats_report(),
+ * including error returns: it closes a phase left open, prints what was
+ * measured up to that point and releases the counters.
+ *
+ * A phase that is begun again under the same name accumulates. Time spent
+ * blocked in the kernel (e.g. waiting for scanf input) counts towards the
+ * phase's wall time but not its counters.
+ */
+
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define PERF_NCOUNTERS  4
+#define PERF_MAX_PHASES 8
+
+static const char *const perf_counter_names[PERF_NCOUNTERS] = {
+    "cycles", "instructions", "cache-misses", "branch-misses"
+};
+static const uint64_t perf_counter_configs[PERF_NCOUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+struct perf_phase {
+    const char *name;
+    double sec;
+    double count[PERF_NCOUNTERS];       /* Scaled for multiplexing */
+};
+
+struct perf_stats {
+    int enabled;
+    int group_fd;                       /* -1: timing only */
+    int fd[PERF_NCOUNTERS];             /* -1: counter not available */
+    int slot[PERF_NCOUNTERS];           /* Position of each counter in a group read */
+    int nopen;
+    char why[96];                       /* Why counters are unavailable */
+    struct perf_phase phase[PERF_MAX_PHASES];
+    int nphases, cur, start_ok;
+    double start_sec;
+    uint64_t start_raw[PERF_NCOUNTERS], start_enabled, start_running;
+};
+
+/* Remove --stats from argv so positional arguments keep their places */
+static inline int perf_stats_flag(int *argc, char **argv) {
+    int found = 0, out = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0)
+            found = 1;
+        else
+            argv[out++] = argv[i];
+    }
+    argv[out] = NULL;
+    *argc = out;
+    return found;
+}
+
+static inline double perf_now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline int perf_open_counter(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static inline void perf_stats_init(struct perf_stats *ps, int enabled) {
+    memset(ps, 0, sizeof(*ps));
+    ps->enabled = enabled;
+    ps->group_fd = -1;
+    ps->cur = -1;
+    for (int i = 0; i < PERF_NCOUNTERS; i++)
+        ps->fd[i] = ps->slot[i] = -1;
+    if (!enabled)
+        return;
+
+    ps->group_fd = ps->fd[0] = perf_open_counter(perf_counter_configs[0], -1);
+    if (ps->group_fd < 0) {
+        snprintf(ps->why, sizeof(ps->why), "perf_event_open: %s", strerror(errno));
+        return;
+    }
+    ps->slot[0] = ps->nopen++;
+    for (int i = 1; i < PERF_NCOUNTERS; i++) {
+        ps->fd[i] = perf_open_counter(perf_counter_configs[i], ps->group_fd);
+        if (ps->fd[i] >= 0)
+            ps->slot[i] = ps->nopen++;
+    }
+}
+
+/* One read returns every counter in the group plus the enabled and
+ * running times used to scale them */
+static inline int perf_read_group(struct perf_stats *ps, uint64_t raw[PERF_NCOUNTERS],
+                                  uint64_t *enabled, uint64_t *running) {
+    uint64_t buf[3 + PERF_NCOUNTERS];
+    if (ps->group_fd < 0 || read(ps->group_fd, buf, sizeof(buf)) < (ssize_t)((3 + ps->nopen) * sizeof(uint64_t)))
+        return -1;
+    *enabled = buf[1];
+    *running = buf[2];
+    for (int i = 0; i < PERF_NCOUNTERS; i++)
+        raw[i] = ps->slot[i] >= 0 ? buf[3 + ps->slot[i]] : 0;
+    return 0;
+}
+
+static inline void perf_phase_begin(struct perf_stats *ps, const char *name) {
+    if (!ps->enabled)
+        return;
+    int p;
+    for (p = 0; p < ps->nphases && strcmp(ps->phase[p].name, name) != 0; p++)
+        ;
+    if (p == ps->nphases) {
+        if (p == PERF_MAX_PHASES)
+            return;
+        ps->phase[ps->nphases++].name = name;
+    }
+    ps->cur = p;
+    ps->start_ok = perf_read_group(ps, ps->start_raw, &ps->start_enabled, &ps->start_running) == 0;
+    ps->start_sec = perf_now_sec();
+}
+
+static inline void perf_phase_end(struct perf_stats *ps) {
+    if (!ps->enabled || ps->cur < 0)
+        return;
+    struct perf_phase *ph = &ps->phase[ps->cur];
+    ph->sec += perf_now_sec() - ps->start_sec;
+
+    uint64_t raw[PERF_NCOUNTERS], en, run;
+    if (ps->start_ok && perf_read_group(ps, raw, &en, &run) == 0) {
+        /* If the group was multiplexed off the PMU for part of the phase,
+         * extrapolate from the time it was actually counting */
+        double scale = run > ps->start_running ? (double)(en - ps->start_enabled) / (run - ps->start_running) : 0;
+        for (int i = 0; i < PERF_NCOUNTERS; i++)
+            ph->count[i] += (raw[i] - ps->start_raw[i]) * scale;
+    }
+    ps->cur = -1;
+}
+
+static inline void perf_stats_report(struct perf_stats *ps) {
+    if (!ps->enabled)
+        return;
+    perf_phase_end(ps);
+    int counters = ps->group_fd >= 0;
+    struct perf_phase total = { "total", 0, { 0 } };
+
+    fflush(stdout);
+    fprintf(stderr, "\n--stats (user space only)\n");
+    if (!counters)
+        fprintf(stderr, "hardware counters unavailable (%s); timing only\n", ps->why);
+    fprintf(stderr, "%-10s %12s", "phase", "time ms");
+    if (counters) {
+        for (int i = 0; i < PERF_NCOUNTERS; i++)
+            if (ps->fd[i] >= 0)
+                fprintf(stderr, " %14s", perf_counter_names[i]);
+        if (ps->fd[1] >= 0)
+            fprintf(stderr, " %6s", "IPC");
+    }
+    fputc('\n', stderr);
+
+    for (int p = 0; p <= ps->nphases; p++) {
+        struct perf_phase *ph = p < ps->nphases ? &ps->phase[p] : &total;
+        if (p < ps->nphases) {
+            total.sec += ph->sec;
+            for (int i = 0; i < PERF_NCOUNTERS; i++)
+                total.count[i] += ph->count[i];
+        }
+        fprintf(stderr, "%-10s %12.3f", ph->name, ph->sec * 1e3);
+        if (counters) {
+            for (int i = 0; i < PERF_NCOUNTERS; i++)
+                if (ps->fd[i] >= 0)
+                    fprintf(stderr, " %14.0f", ph->count[i]);
+            if (ps->fd[1] >= 0 && ph->count[0] > 0)
+                fprintf(stderr, " %6.2f", ph->count[1] / ph->count[0]);
+        }
+        fputc('\n', stderr);
+    }
+
+    for (int i = 0; i < PERF_NCOUNTERS; i++)
+        if (ps->fd[i] >= 0)
+            close(ps->fd[i]);
+    ps->group_fd = -1;
+}
+
+#endif /* PERFSTATS_H */
@@ -1,18 +1,289 @@
 //One way communication using pipe
+//
+// ./pipe_one_way                    interactive: parent sends one line to the child
+// ./pipe_one_way stream [-s MB] [-b KB] [-p KB] [-m method]
+//
+// Streaming mode pushes a large payload from parent to child and reports
+// GB/s for each transfer method:
+//   rw        write() into the pipe, read() out of it (two copies)
+//   vmsplice  vmsplice() user pages into the pipe, read() out of it
+//   splice    vmsplice() into the pipe, splice() out to /dev/null (zero copy)
+// -s total size (default 1024 MB), -b user buffer (default 256 KB),
+// -p pipe capacity set with F_SETPIPE_SZ (default 1024 KB), -m one method
+//
+// The first 8 bytes of every 4 KB page of the stream hold the page's index
+// in the stream; the rw and vmsplice readers check them, so a short write,
+// a lost or repeated chunk, or a page overwritten while still in the pipe
+// makes the run fail. splice to /dev/null only checks the byte count.
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #define MAX 20
+#define STAMP_EVERY 4096
 
-int main()
+enum { METHOD_RW, METHOD_VMSPLICE, METHOD_SPLICE, METHOD_COUNT };
+static const char *method_names[METHOD_COUNT] = { "rw", "vmsplice", "splice" };
+
+// Write all of buf, retrying on partial writes and EINTR
+static int write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Map all of buf into the pipe; vmsplice may accept only part of it
+static int vmsplice_all(int fd, char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        struct iovec iov = { buf, len };
+        ssize_t n = vmsplice(fd, &iov, 1, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Stamp each page of buf with its index in the stream
+static void stamp_pages(char *buf, size_t len, long long offset)
+{
+    for (size_t off = 0; off < len; off += STAMP_EVERY)
+    {
+        uint64_t page = (offset + off) / STAMP_EVERY;
+        memcpy(buf + off, &page, sizeof(page));
+    }
+}
+
+// Check the stamps in n bytes that start at stream offset `offset`; a stamp
+// may be split across two reads
+static int check_stamps(const unsigned char *p, size_t n, long long offset)
+{
+    const unsigned char *end = p + n;
+    while (p < end)
+    {
+        long long in_page = offset % STAMP_EVERY;
+        if (in_page >= (long long)sizeof(uint64_t))
+        {
+            long long skip = STAMP_EVERY - in_page;
+            if (skip > end - p)
+                skip = end - p;
+            p += skip;
+            offset += skip;
+            continue;
+        }
+        uint64_t page = offset / STAMP_EVERY;
+        if (*p != (unsigned char)(page >> (8 * in_page)))
+            return -1;
+        p++;
+        offset++;
+    }
+    return 0;
+}
+
+// Child side: drain the pipe until EOF and return the number of bytes seen,
+// or -1 on an error or a stamp that does not match its position
+static long long drain(int fd, int method, size_t bufsize)
+{
+    long long total = 0;
+    ssize_t n;
+
+    if (method == METHOD_SPLICE)
+    {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull < 0)
+            return -1;
+        while ((n = splice(fd, NULL, devnull, NULL, 1 << 30, SPLICE_F_MOVE)) != 0)
+        {
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+            total += n;
+        }
+        close(devnull);
+        return total;
+    }
+
+    char *buf = malloc(bufsize);
+    if (!buf)
+        return -1;
+    while ((n = read(fd, buf, bufsize)) != 0)
+    {
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            free(buf);
+            return -1;
+        }
+        if (check_stamps((unsigned char *)buf, n, total) < 0)
+        {
+            fprintf(stderr, "%s: wrong data at offset %lld\n", method_names[method], total);
+            free(buf);
+            return -1;
+        }
+        total += n;
+    }
+    free(buf);
+    return total;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Transfer total bytes with one method; returns GB/s or a negative value on error
+static double stream_once(int method, long long total, size_t bufsize, int pipesize)
+{
+    int filedes[2];
+    pid_t pid;
+
+    if (pipe(filedes) < 0)
+        return -1;
+    if (pipesize > 0 && fcntl(filedes[1], F_SETPIPE_SZ, pipesize) < 0)
+        fprintf(stderr, "F_SETPIPE_SZ(%d): %s\n", pipesize, strerror(errno));
+
+    if ((pid = fork()) < 0)
+        return -1;
+
+    if (pid == 0)
+    {
+        close(filedes[1]);
+        long long got = drain(filedes[0], method, bufsize);
+        _exit(got == total ? 0 : 1);
+    }
+
+    close(filedes[0]);
+
+    // vmsplice without SPLICE_F_GIFT leaves the pipe referencing our pages
+    // until the reader consumes them, so a buffer may only be rewritten
+    // once a pipe's worth of later data has gone in behind it: rotate
+    // through capacity / bufsize + 1 buffers
+    int capacity = fcntl(filedes[1], F_GETPIPE_SZ);
+    int nbufs = capacity > 0 ? (capacity + bufsize - 1) / bufsize + 1 : 2;
+    char *bufs = aligned_alloc(4096, bufsize * nbufs);
+    memset(bufs, 'x', bufsize * nbufs);     // Touch the pages before timing starts
+
+    double start = now_sec();
+    int err = 0, cur = 0;
+    for (long long sent = 0; sent < total && !err; cur = (cur + 1) % nbufs)
+    {
+        char *buf = bufs + (size_t)cur * bufsize;
+        size_t len = total - sent < (long long)bufsize ? (size_t)(total - sent) : bufsize;
+        stamp_pages(buf, len, sent);
+        if (method == METHOD_RW)
+            err = write_all(filedes[1], buf, len);
+        else
+            err = vmsplice_all(filedes[1], buf, len);
+        sent += len;
+    }
+    close(filedes[1]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    double elapsed = now_sec() - start;
+    free(bufs);
+
+    if (err || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return -1;
+    return total / elapsed / 1e9;
+}
+
+static int stream_main(int argc, char **argv)
+{
+    long long total = 1024LL << 20;
+    size_t bufsize = 256 << 10;
+    int pipesize = 1024 << 10;
+    int only = -1, opt;
+
+    while ((opt = getopt(argc, argv, "s:b:p:m:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': total = atoll(optarg) << 20; break;
+        case 'b': bufsize = (size_t)atol(optarg) << 10; break;
+        case 'p': pipesize = atoi(optarg) << 10; break;
+        case 'm':
+            for (only = 0; only < METHOD_COUNT; only++)
+                if (strcmp(optarg, method_names[only]) == 0)
+                    break;
+            if (only == METHOD_COUNT)
+            {
+                fprintf(stderr, "Unknown method '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            return 1;
+        }
+    }
+    if (total <= 0 || bufsize == 0 || bufsize % 4096 != 0)
+    {
+        fprintf(stderr, "Size must be positive and buffer a multiple of 4 KB\n");
+        return 1;
+    }
+
+    // A reader that rejects the data exits early; report it instead of dying
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Streaming %lld MB, buffer %zu KB, pipe %d KB\n",
+           total >> 20, bufsize >> 10, pipesize >> 10);
+    for (int m = 0; m < METHOD_COUNT; m++)
+    {
+        if (only >= 0 && m != only)
+            continue;
+        double gbps = stream_once(m, total, bufsize, pipesize);
+        if (gbps < 0)
+            printf("%-9s failed\n", method_names[m]);
+        else
+            printf("%-9s %8.2f GB/s\n", method_names[m], gbps);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
     int filedes[2],n;
     char string[MAX];
     char line[MAX];
     pid_t pid;
 
+    if (argc >= 2 && strcmp(argv[1], "stream") == 0)
+        return stream_main(argc - 1, argv + 1);
+
     printf("Enter a string to be given to the parent: ");
     fflush(stdin);
     fgets(string,MAX,stdin);
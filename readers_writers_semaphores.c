@@ -1,36 +1,549 @@
+/* readers_writers_semaphores.c
+ * Readers-writers problem with a choice of locking protocol.
+ *
+ *   sem    - classic reader-preference solution with two semaphores (default)
+ *   bravo  - big-reader lock: per-CPU reader indicators, writers drain them all
+ *   wpref  - writer preference: a waiting writer blocks new readers
+ *   fair   - phase-fair ticket lock: reader and writer phases alternate
+ *   seqlock- optimistic readers retry if a writer intervened
+ *   rcu    - readers follow a published pointer, writers swap in a new copy
+ *            and free the old one after a grace period
+ *   rwlock - pthread_rwlock_t
+ *   mutex  - pthread_mutex_t, readers and writers alike
+ *   ticket - ticket spinlock, readers and writers alike
+ *   futex  - futex-based mutex (uncontended path stays in user space)
+ *
+ * Every thread records how long it waited to enter its critical section and
+ * p50/p99/max are printed per role at the end.
+ *
+ * "bench" runs pinned worker threads against the chosen modes for a fixed
+ * time and reports ops/sec and acquire latency histograms per role.
+ *
+ * Compile: gcc -Wall -O2 -pthread -o rw readers_writers_semaphores.c
+ * Run:     ./rw [mode]
+ *          ./rw bench [-m mode,...] [-t threads,...] [-r read%,...] [-d seconds]
+ *                     [-n cs_ns] [-l cs_lines] [-u] [-H]
+ *
+ *   -m  modes to compare (default: all)
+ *   -t  worker thread counts (default: number of CPUs)
+ *   -r  percentage of operations that are reads (default: 50,90,99,100)
+ *   -d  duration of each run in seconds (default: 1)
+ *   -n  busy-wait this many ns inside every critical section
+ *   -l  touch this many cache lines inside every critical section
+ *   -u  do not pin threads to CPUs
+ *   -H  print the full latency histograms
+ */
+
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
 #include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define CACHE_LINE 64
+#define RW_STRIPES 64           // Reader indicators (power of two)
+
+#define PAYLOAD_INTS 15         // Pads the shared record to one cache line
+
+enum rw_mode {
+    MODE_SEM, MODE_BRAVO, MODE_WPREF, MODE_FAIR, MODE_SEQLOCK, MODE_RCU,
+    MODE_RWLOCK, MODE_MUTEX, MODE_TICKET, MODE_FUTEX, MODE_COUNT
+};
+static const char *mode_names[MODE_COUNT] = {
+    "sem", "bravo", "wpref", "fair", "seqlock", "rcu",
+    "rwlock", "mutex", "ticket", "futex"
+};
+static enum rw_mode mode = MODE_SEM;
+
+/* Shared data. A writer stores the new value in every field, so a reader
+ * that sees mixed values has observed a torn update.
+ */
+struct shared_record {
+    int value;
+    int payload[PAYLOAD_INTS];
+};
 
 sem_t mutex, wrt;       // Semaphores
-int sharedvar = 99;     // Shared variable
+struct shared_record sharedvar;                     // Shared variable
 int readcount = 0;      // Number of readers currently reading
 
-// Reader thread function
-void* reader(void* arg) {
-    int id = *((int*)arg);
-    free(arg);  // Free the allocated memory for ID
+sem_t wmutex, readtry;  // Writer-preference: guard writecount, gate new readers
+int writecount = 0;     // Number of writers waiting or writing
+
+double *reader_wait_us; // Acquire latency of each reader
+double *writer_wait_us; // Acquire latency of each writer
+
+/* Big-reader lock: each reader only touches the indicator of the CPU it runs
+ * on, so concurrent readers on different CPUs never share a cache line.
+ * A writer raises writer_active and then waits for every indicator to drain.
+ */
+struct reader_stripe {
+    atomic_int readers;
+    char pad[CACHE_LINE - sizeof(atomic_int)];
+};
+
+static struct reader_stripe stripes[RW_STRIPES] __attribute__((aligned(CACHE_LINE)));
+static atomic_int writer_active __attribute__((aligned(CACHE_LINE)));
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int bravo_read_lock(void) {
+    for (;;) {
+        int cpu = sched_getcpu();
+        int slot = (cpu < 0 ? 0 : cpu) & (RW_STRIPES - 1);
+
+        atomic_fetch_add(&stripes[slot].readers, 1);
+        if (!atomic_load(&writer_active))
+            return slot;       // Fast path: no shared write
+
+        // A writer is draining; back off so it can make progress
+        atomic_fetch_sub(&stripes[slot].readers, 1);
+        while (atomic_load_explicit(&writer_active, memory_order_relaxed))
+            sched_yield();
+    }
+}
+
+static void bravo_read_unlock(int slot) {
+    atomic_fetch_sub_explicit(&stripes[slot].readers, 1, memory_order_release);
+}
+
+static void bravo_write_lock(void) {
+    pthread_mutex_lock(&writer_lock);
+    atomic_store(&writer_active, 1);
+    for (int i = 0; i < RW_STRIPES; i++)
+        while (atomic_load(&stripes[i].readers) != 0)
+            sched_yield();
+}
+
+static void bravo_write_unlock(void) {
+    atomic_store(&writer_active, 0);
+    pthread_mutex_unlock(&writer_lock);
+}
+
+/* Phase-fair ticket lock (Brandenburg & Anderson). Readers arriving while a
+ * writer holds or waits for the lock block only until that one writer is
+ * done; a writer waits only for readers that were already inside. Neither
+ * role can starve the other.
+ */
+#define PF_RINC  0x100u         // Reader increment
+#define PF_WBITS 0x3u           // Writer bits in rin
+#define PF_PRES  0x2u           // Writer present
+#define PF_PHID  0x1u           // Writer phase id
+
+static atomic_uint pf_rin, pf_rout, pf_win, pf_wout;
+
+static void fair_read_lock(void) {
+    unsigned w = atomic_fetch_add(&pf_rin, PF_RINC) & PF_WBITS;
+    if (w != 0)
+        while (w == (atomic_load(&pf_rin) & PF_WBITS))
+            sched_yield();
+}
+
+static void fair_read_unlock(void) {
+    atomic_fetch_add(&pf_rout, PF_RINC);
+}
+
+static void fair_write_lock(void) {
+    unsigned ticket = atomic_fetch_add(&pf_win, 1);
+    while (atomic_load(&pf_wout) != ticket)
+        sched_yield();
+
+    unsigned w = PF_PRES | (ticket & PF_PHID);
+    unsigned rticket = atomic_fetch_add(&pf_rin, w);
+    while (atomic_load(&pf_rout) != rticket)
+        sched_yield();
+}
+
+static void fair_write_unlock(void) {
+    atomic_fetch_and(&pf_rin, ~PF_WBITS);
+    atomic_fetch_add(&pf_wout, 1);
+}
+
+/* Seqlock: the counter is odd while a write is in progress. Readers copy the
+ * record without locking and retry if the counter moved underneath them.
+ * Fields are accessed with relaxed atomics so the racy copy is well defined.
+ */
+static atomic_uint seq;
+static struct shared_record seq_rec;
+
+static void seq_read(struct shared_record *out) {
+    for (;;) {
+        unsigned s1 = atomic_load_explicit(&seq, memory_order_acquire);
+        if (s1 & 1) {
+            sched_yield();
+            continue;
+        }
+        out->value = __atomic_load_n(&seq_rec.value, __ATOMIC_RELAXED);
+        for (int i = 0; i < PAYLOAD_INTS; i++)
+            out->payload[i] = __atomic_load_n(&seq_rec.payload[i], __ATOMIC_RELAXED);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&seq, memory_order_relaxed) == s1)
+            return;
+    }
+}
+
+/* Caller holds writer_lock */
+static int seq_write(void) {
+    int value = seq_rec.value + 1;
+    atomic_store_explicit(&seq, atomic_load_explicit(&seq, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    __atomic_store_n(&seq_rec.value, value, __ATOMIC_RELAXED);
+    for (int i = 0; i < PAYLOAD_INTS; i++)
+        __atomic_store_n(&seq_rec.payload[i], value, __ATOMIC_RELAXED);
+    atomic_store_explicit(&seq, atomic_load_explicit(&seq, memory_order_relaxed) + 1,
+                          memory_order_release);
+    return value;
+}
+
+/* RCU-style publication. Readers mark themselves active in the per-CPU
+ * counter for the current epoch and dereference rcu_rec without locking.
+ * A writer publishes a new copy, flips the epoch and waits until no reader
+ * is left in the old one before freeing the previous copy.
+ */
+struct rcu_stripe {
+    atomic_int active[2];
+    char pad[CACHE_LINE - 2 * sizeof(atomic_int)];
+};
+
+static struct rcu_stripe rcu_stripes[RW_STRIPES] __attribute__((aligned(CACHE_LINE)));
+static atomic_uint rcu_epoch __attribute__((aligned(CACHE_LINE)));
+static struct shared_record *_Atomic rcu_rec;
+
+static int rcu_read_lock(void) {
+    for (;;) {
+        int cpu = sched_getcpu();
+        int slot = (cpu < 0 ? 0 : cpu) & (RW_STRIPES - 1);
+        unsigned e = atomic_load(&rcu_epoch) & 1;
+
+        atomic_fetch_add(&rcu_stripes[slot].active[e], 1);
+        if ((atomic_load(&rcu_epoch) & 1) == e)
+            return slot * 2 + e;
+        atomic_fetch_sub(&rcu_stripes[slot].active[e], 1);   // Raced with a flip
+    }
+}
+
+static void rcu_read_unlock(int token) {
+    atomic_fetch_sub_explicit(&rcu_stripes[token / 2].active[token & 1], 1,
+                              memory_order_release);
+}
+
+/* Wait for every reader that might still see the previous copy */
+static void rcu_synchronize(void) {
+    unsigned old = atomic_fetch_add(&rcu_epoch, 1) & 1;
+    for (int i = 0; i < RW_STRIPES; i++)
+        while (atomic_load(&rcu_stripes[i].active[old]) != 0)
+            sched_yield();
+}
+
+/* Caller holds writer_lock */
+static int rcu_write(void) {
+    struct shared_record *old = atomic_load_explicit(&rcu_rec, memory_order_relaxed);
+    struct shared_record *copy = malloc(sizeof(*copy));
+
+    copy->value = old->value + 1;
+    for (int i = 0; i < PAYLOAD_INTS; i++)
+        copy->payload[i] = copy->value;
+    atomic_store_explicit(&rcu_rec, copy, memory_order_release);
+
+    rcu_synchronize();
+    free(old);                 // Deferred until the grace period ended
+    return copy->value;
+}
+
+static pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t plain_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Ticket spinlock: FIFO hand-off, spins in user space. Yields now and then so
+ * that oversubscribed runs still make progress.
+ */
+static struct {
+    atomic_uint next;
+    atomic_uint owner;
+} ticket_lock __attribute__((aligned(CACHE_LINE)));
+
+static void ticket_acquire(void) {
+    unsigned me = atomic_fetch_add_explicit(&ticket_lock.next, 1, memory_order_relaxed);
+    for (unsigned spins = 0;
+         atomic_load_explicit(&ticket_lock.owner, memory_order_acquire) != me; spins++) {
+        if ((spins & 1023) == 1023)
+            sched_yield();
+        else
+            cpu_relax();
+    }
+}
+
+static void ticket_release(void) {
+    atomic_fetch_add_explicit(&ticket_lock.owner, 1, memory_order_release);
+}
+
+/* Futex mutex (Drepper, "Futexes Are Tricky"): 0 = free, 1 = locked,
+ * 2 = locked with waiters. Only contended paths enter the kernel.
+ */
+static atomic_int futex_word __attribute__((aligned(CACHE_LINE)));
+
+static void futex_acquire(void) {
+    int c = 0;
+    if (atomic_compare_exchange_strong(&futex_word, &c, 1))
+        return;
+    if (c != 2)
+        c = atomic_exchange(&futex_word, 2);
+    while (c != 0) {
+        syscall(SYS_futex, &futex_word, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+        c = atomic_exchange(&futex_word, 2);
+    }
+}
+
+static void futex_release(void) {
+    if (atomic_fetch_sub(&futex_word, 1) != 1) {
+        atomic_store(&futex_word, 0);
+        syscall(SYS_futex, &futex_word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+/* Take a mode's exclusive lock; returns 0 for modes that have none */
+static int exclusive_enter(void) {
+    switch (mode) {
+    case MODE_MUTEX:  pthread_mutex_lock(&plain_mutex); return 1;
+    case MODE_TICKET: ticket_acquire();                 return 1;
+    case MODE_FUTEX:  futex_acquire();                  return 1;
+    default:          return 0;
+    }
+}
+
+static int exclusive_exit(void) {
+    switch (mode) {
+    case MODE_MUTEX:  pthread_mutex_unlock(&plain_mutex); return 1;
+    case MODE_TICKET: ticket_release();                   return 1;
+    case MODE_FUTEX:  futex_release();                    return 1;
+    default:          return 0;
+    }
+}
+
+/* Entry section for readers; returns a token to hand back to reader_exit() */
+static int reader_enter(void) {
+    if (exclusive_enter())
+        return 0;
+
+    switch (mode) {
+    case MODE_RWLOCK:
+        pthread_rwlock_rdlock(&rwlock);
+        return 0;
+    case MODE_BRAVO:
+        return bravo_read_lock();
+    case MODE_FAIR:
+        fair_read_lock();
+        return 0;
+    case MODE_SEQLOCK:
+        return 0;              // Validated inside read_shared()
+    case MODE_RCU:
+        return rcu_read_lock();
+    case MODE_WPREF:
+        sem_wait(&readtry);    // Held by writers while any are waiting
+        break;
+    default:
+        break;
+    }
 
-    // Entry section
     sem_wait(&mutex);
     readcount++;
     if (readcount == 1)        // First reader locks writers
         sem_wait(&wrt);
     sem_post(&mutex);
 
-    // Critical section (reading)
-    printf("Reader %d is reading sharedvar = %d\n", id, sharedvar);
-    sleep(1); // Simulate reading
-    printf("Reader %d finished reading\n", id);
+    if (mode == MODE_WPREF)
+        sem_post(&readtry);
+    return 0;
+}
+
+static void reader_exit(int token) {
+    if (exclusive_exit())
+        return;
+
+    switch (mode) {
+    case MODE_RWLOCK:
+        pthread_rwlock_unlock(&rwlock);
+        return;
+    case MODE_BRAVO:
+        bravo_read_unlock(token);
+        return;
+    case MODE_FAIR:
+        fair_read_unlock();
+        return;
+    case MODE_SEQLOCK:
+        return;
+    case MODE_RCU:
+        rcu_read_unlock(token);
+        return;
+    default:
+        break;
+    }
 
-    // Exit section
     sem_wait(&mutex);
     readcount--;
     if (readcount == 0)        // Last reader unlocks writers
         sem_post(&wrt);
     sem_post(&mutex);
+}
+
+/* Writers only exclude each other in the seqlock and RCU modes; readers
+ * are never blocked for the length of the writer's critical section.
+ */
+static void writer_enter(void) {
+    if (exclusive_enter())
+        return;
+
+    switch (mode) {
+    case MODE_RWLOCK:
+        pthread_rwlock_wrlock(&rwlock);
+        break;
+    case MODE_BRAVO:
+        bravo_write_lock();
+        break;
+    case MODE_SEQLOCK:
+    case MODE_RCU:
+        pthread_mutex_lock(&writer_lock);
+        break;
+    case MODE_FAIR:
+        fair_write_lock();
+        break;
+    case MODE_WPREF:
+        sem_wait(&wmutex);
+        writecount++;
+        if (writecount == 1)   // First waiting writer shuts out new readers
+            sem_wait(&readtry);
+        sem_post(&wmutex);
+        sem_wait(&wrt);
+        break;
+    default:
+        sem_wait(&wrt);
+        break;
+    }
+}
+
+static void writer_exit(void) {
+    if (exclusive_exit())
+        return;
+
+    switch (mode) {
+    case MODE_RWLOCK:
+        pthread_rwlock_unlock(&rwlock);
+        break;
+    case MODE_BRAVO:
+        bravo_write_unlock();
+        break;
+    case MODE_SEQLOCK:
+    case MODE_RCU:
+        pthread_mutex_unlock(&writer_lock);
+        break;
+    case MODE_FAIR:
+        fair_write_unlock();
+        break;
+    case MODE_WPREF:
+        sem_post(&wrt);
+        sem_wait(&wmutex);
+        writecount--;
+        if (writecount == 0)   // Last writer lets readers in again
+            sem_post(&readtry);
+        sem_post(&wmutex);
+        break;
+    default:
+        sem_post(&wrt);
+        break;
+    }
+}
+
+/* Copy the shared record; call between reader_enter() and reader_exit() */
+static void read_shared(struct shared_record *out) {
+    switch (mode) {
+    case MODE_SEQLOCK:
+        seq_read(out);
+        break;
+    case MODE_RCU:
+        *out = *atomic_load_explicit(&rcu_rec, memory_order_acquire);
+        break;
+    default:
+        *out = sharedvar;
+        break;
+    }
+}
+
+/* Bump the shared value; call between writer_enter() and writer_exit() */
+static int write_shared(void) {
+    switch (mode) {
+    case MODE_SEQLOCK:
+        return seq_write();
+    case MODE_RCU:
+        return rcu_write();
+    default:
+        sharedvar.value++;
+        for (int i = 0; i < PAYLOAD_INTS; i++)
+            sharedvar.payload[i] = sharedvar.value;
+        return sharedvar.value;
+    }
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of an already sorted array */
+static double percentile(const double *sorted, int n, double p) {
+    int rank = (int)(p * n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static void print_latency(const char *role, double *samples, int n) {
+    if (n == 0)
+        return;
+    qsort(samples, n, sizeof(*samples), cmp_double);
+    printf("%-7s n=%-4d p50=%10.1f us  p99=%10.1f us  max=%10.1f us\n", role, n,
+           percentile(samples, n, 0.50), percentile(samples, n, 0.99), samples[n - 1]);
+}
+
+// Reader thread function
+void* reader(void* arg) {
+    int id = *((int*)arg);
+    free(arg);  // Free the allocated memory for ID
+
+    // Entry section
+    double start = now_us();
+    int token = reader_enter();
+    reader_wait_us[id - 1] = now_us() - start;
+
+    // Critical section (reading)
+    struct shared_record snapshot;
+    read_shared(&snapshot);
+    printf("Reader %d is reading sharedvar = %d\n", id, snapshot.value);
+    sleep(1); // Simulate reading
+    printf("Reader %d finished reading\n", id);
+
+    // Exit section
+    reader_exit(token);
 
     pthread_exit(NULL);
 }
@@ -42,30 +555,342 @@ void* writer(void* arg) {
 
     // Entry section
     printf("Writer %d is trying to enter CS\n", id);
-    sem_wait(&wrt);
+    double start = now_us();
+    writer_enter();
+    writer_wait_us[id - 1] = now_us() - start;
 
     // Critical section (writing)
     printf("Writer %d has entered CS\n", id);
-    sharedvar++;
-    printf("Writer %d changed sharedvar to %d\n", id, sharedvar);
+    int value = write_shared();
+    printf("Writer %d changed sharedvar to %d\n", id, value);
     sleep(2); // Simulate writing
     printf("Writer %d is leaving CS\n", id);
 
-    sem_post(&wrt);
+    writer_exit();
 
     pthread_exit(NULL);
 }
 
-int main() {
-    int n_readers, n_writers;
-    printf("Enter number of readers and writers: ");
-    scanf("%d %d", &n_readers, &n_writers);
+/* Benchmark settings shared by all workers */
+#define HIST_BUCKETS 40         // log2(ns) buckets: 1 ns .. ~9 minutes
+#define MAX_LIST 16
+
+static struct {
+    double seconds;
+    long cs_ns;                 // Busy-wait inside the critical section
+    int cs_lines;               // Cache lines touched inside the critical section
+    int pin;
+    int histograms;
+} bench = { 1.0, 0, 0, 1, 0 };
+
+static uint64_t *cs_buf;        // cs_lines cache lines, one counter each
+static atomic_int bench_stop;
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline int hist_bucket(uint64_t ns) {
+    int b = ns ? 64 - __builtin_clzll(ns) : 0;
+    return b < HIST_BUCKETS ? b : HIST_BUCKETS - 1;
+}
 
-    pthread_t rtid[n_readers], wtid[n_writers];
+/* Per-role latency histogram; bucket b holds samples in [2^(b-1), 2^b) ns */
+struct latency_hist {
+    unsigned long count[HIST_BUCKETS];
+    unsigned long total;
+    uint64_t max;
+};
 
-    // Initialize semaphores
+static void hist_add(struct latency_hist *h, uint64_t ns) {
+    h->count[hist_bucket(ns)]++;
+    h->total++;
+    if (ns > h->max)
+        h->max = ns;
+}
+
+static void hist_merge(struct latency_hist *dst, const struct latency_hist *src) {
+    for (int b = 0; b < HIST_BUCKETS; b++)
+        dst->count[b] += src->count[b];
+    dst->total += src->total;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+/* Upper bound of the bucket holding the p-th percentile */
+static uint64_t hist_percentile(const struct latency_hist *h, double p) {
+    unsigned long rank = (unsigned long)(p * h->total + 0.999999), seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->count[b];
+        if (seen >= rank && h->count[b])
+            return b ? (1ull << b) - 1 : 0;
+    }
+    return h->max;
+}
+
+static void hist_print(const char *role, const struct latency_hist *h) {
+    unsigned long peak = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++)
+        if (h->count[b] > peak)
+            peak = h->count[b];
+    printf("  %s acquire latency:\n", role);
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (!h->count[b])
+            continue;
+        int bar = (int)(50.0 * h->count[b] / peak + 0.5);
+        printf("  %10llu - %10llu ns %12lu |%.*s\n",
+               b ? 1ull << (b - 1) : 0ull, b ? (1ull << b) - 1 : 0ull, h->count[b], bar,
+               "##################################################");
+    }
+}
+
+/* Simulated work while holding the lock */
+static void critical_section(int write) {
+    static __thread uint64_t sink;
+    for (int i = 0; i < bench.cs_lines; i++) {
+        uint64_t *line = cs_buf + (size_t)i * (CACHE_LINE / sizeof(uint64_t));
+        uint64_t v = __atomic_load_n(line, __ATOMIC_RELAXED);
+        if (write)
+            __atomic_store_n(line, v + 1, __ATOMIC_RELAXED);
+        else
+            sink += v;
+    }
+    if (bench.cs_ns > 0) {
+        uint64_t end = now_ns() + bench.cs_ns;
+        while (now_ns() < end)
+            cpu_relax();
+    }
+}
+
+/* Benchmark worker: mixes reads and writes at read_pct percent reads until
+ * told to stop. Each worker's counters sit on their own cache line.
+ */
+struct bench_worker {
+    pthread_t tid;
+    int cpu;
+    int read_pct;
+    unsigned seed;
+    unsigned long torn;
+    struct latency_hist lat[2];         // [0] reads, [1] writes
+} __attribute__((aligned(CACHE_LINE)));
+
+static void* bench_thread(void* arg) {
+    struct bench_worker *w = arg;
+    struct shared_record snapshot;
+    unsigned x = w->seed;
+
+    if (w->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    while (!atomic_load_explicit(&bench_stop, memory_order_relaxed)) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;       // xorshift32
+        uint64_t start = now_ns();
+        if ((int)(x % 100) < w->read_pct) {
+            int token = reader_enter();
+            hist_add(&w->lat[0], now_ns() - start);
+            read_shared(&snapshot);
+            critical_section(0);
+            reader_exit(token);
+            if (snapshot.payload[PAYLOAD_INTS - 1] != snapshot.value)
+                w->torn++;
+        } else {
+            writer_enter();
+            hist_add(&w->lat[1], now_ns() - start);
+            write_shared();
+            critical_section(1);
+            writer_exit();
+        }
+    }
+    return NULL;
+}
+
+static void init_shared(void) {
     sem_init(&mutex, 0, 1);
     sem_init(&wrt, 0, 1);
+    sem_init(&wmutex, 0, 1);
+    sem_init(&readtry, 0, 1);
+
+    sharedvar.value = 99;
+    for (int i = 0; i < PAYLOAD_INTS; i++)
+        sharedvar.payload[i] = sharedvar.value;
+    seq_rec = sharedvar;
+
+    struct shared_record *rec = malloc(sizeof(*rec));
+    *rec = sharedvar;
+    atomic_store(&rcu_rec, rec);
+}
+
+static void run_once(int nthreads, int read_pct) {
+    struct bench_worker *workers = aligned_alloc(CACHE_LINE, nthreads * sizeof(*workers));
+    cpu_set_t allowed;
+    int ncpus = 0, cpus[CPU_SETSIZE];
+
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for (int c = 0; c < CPU_SETSIZE; c++)
+        if (CPU_ISSET(c, &allowed))
+            cpus[ncpus++] = c;
+
+    atomic_store(&bench_stop, 0);
+    for (int i = 0; i < nthreads; i++) {
+        memset(&workers[i], 0, sizeof(workers[i]));
+        workers[i].cpu = bench.pin && ncpus ? cpus[i % ncpus] : -1;
+        workers[i].read_pct = read_pct;
+        workers[i].seed = 2463534242u + i * 7919u;
+        pthread_create(&workers[i].tid, NULL, bench_thread, &workers[i]);
+    }
+
+    usleep((useconds_t)(bench.seconds * 1e6));
+    atomic_store(&bench_stop, 1);
+
+    struct latency_hist lat[2];
+    unsigned long torn = 0;
+    memset(lat, 0, sizeof(lat));
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(workers[i].tid, NULL);
+        hist_merge(&lat[0], &workers[i].lat[0]);
+        hist_merge(&lat[1], &workers[i].lat[1]);
+        torn += workers[i].torn;
+    }
+
+    printf("%-8s %4d %5d %13.0f %13.0f %13.0f", mode_names[mode], nthreads, read_pct,
+           (lat[0].total + lat[1].total) / bench.seconds,
+           lat[0].total / bench.seconds, lat[1].total / bench.seconds);
+    for (int r = 0; r < 2; r++) {
+        if (lat[r].total)
+            printf(" %9llu %9llu %10llu",
+                   (unsigned long long)hist_percentile(&lat[r], 0.50),
+                   (unsigned long long)hist_percentile(&lat[r], 0.99),
+                   (unsigned long long)lat[r].max);
+        else
+            printf(" %9s %9s %10s", "-", "-", "-");
+    }
+    printf("%s\n", torn ? "  TORN READS" : "");
+
+    if (bench.histograms) {
+        if (lat[0].total) hist_print("read", &lat[0]);
+        if (lat[1].total) hist_print("write", &lat[1]);
+    }
+    free(workers);
+}
+
+/* Parse "a,b,c" into out[]; returns count or -1 */
+static int parse_list(const char *s, int out[], int max) {
+    int n = 0;
+    char *end;
+    while (*s && n < max) {
+        long v = strtol(s, &end, 10);
+        if (end == s || v < 0)
+            return -1;
+        out[n++] = (int)v;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return *s ? -1 : n;
+}
+
+static int parse_modes(const char *s, int out[], int max) {
+    int n = 0;
+    while (*s && n < max) {
+        size_t len = strcspn(s, ",");
+        int m;
+        for (m = 0; m < MODE_COUNT; m++)
+            if (strlen(mode_names[m]) == len && strncmp(s, mode_names[m], len) == 0)
+                break;
+        if (m == MODE_COUNT)
+            return -1;
+        out[n++] = m;
+        s += len;
+        if (*s == ',')
+            s++;
+    }
+    return n;
+}
+
+static int run_bench(int argc, char **argv) {
+    int modes[MODE_COUNT], nmodes = MODE_COUNT;
+    int threads[MAX_LIST], nthreads = 1;
+    int read_pcts[MAX_LIST] = { 50, 90, 99, 100 }, nread_pcts = 4;
+    int opt;
+
+    for (int m = 0; m < MODE_COUNT; m++)
+        modes[m] = m;
+    threads[0] = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "m:t:r:d:n:l:uH")) != -1) {
+        switch (opt) {
+        case 'm': nmodes = parse_modes(optarg, modes, MODE_COUNT); break;
+        case 't': nthreads = parse_list(optarg, threads, MAX_LIST); break;
+        case 'r': nread_pcts = parse_list(optarg, read_pcts, MAX_LIST); break;
+        case 'd': bench.seconds = atof(optarg); break;
+        case 'n': bench.cs_ns = atol(optarg); break;
+        case 'l': bench.cs_lines = atoi(optarg); break;
+        case 'u': bench.pin = 0; break;
+        case 'H': bench.histograms = 1; break;
+        default:  return 1;
+        }
+    }
+    if (nmodes <= 0 || nthreads <= 0 || nread_pcts <= 0 || bench.seconds <= 0 ||
+        bench.cs_ns < 0 || bench.cs_lines < 0) {
+        fprintf(stderr, "bench: invalid option value\n");
+        return 1;
+    }
+
+    init_shared();
+    if (bench.cs_lines > 0)
+        cs_buf = aligned_alloc(CACHE_LINE, (size_t)bench.cs_lines * CACHE_LINE);
+    if (cs_buf)
+        memset(cs_buf, 0, (size_t)bench.cs_lines * CACHE_LINE);
+
+    printf("%.2f s per run, critical section %ld ns + %d cache lines, threads %s\n",
+           bench.seconds, bench.cs_ns, bench.cs_lines, bench.pin ? "pinned" : "unpinned");
+    printf("%-8s %4s %5s %13s %13s %13s %9s %9s %10s %9s %9s %10s\n",
+           "mode", "thr", "read%", "ops/s", "reads/s", "writes/s",
+           "rd p50ns", "rd p99ns", "rd max ns", "wr p50ns", "wr p99ns", "wr max ns");
+
+    for (int t = 0; t < nthreads; t++)
+        for (int r = 0; r < nread_pcts; r++)
+            for (int m = 0; m < nmodes; m++) {
+                mode = modes[m];
+                run_once(threads[t] > 0 ? threads[t] : 1, read_pcts[r] > 100 ? 100 : read_pcts[r]);
+            }
+
+    free(cs_buf);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+        return run_bench(argc - 1, argv + 1);
+
+    if (argc >= 2) {
+        int m;
+        for (m = 0; m < MODE_COUNT; m++)
+            if (strcmp(argv[1], mode_names[m]) == 0)
+                break;
+        if (m == MODE_COUNT) {
+            fprintf(stderr, "Usage: %s [sem|bravo|wpref|fair|seqlock|rcu|rwlock|mutex|ticket|futex]\n"
+                            "       %s bench [-m modes] [-t threads] [-r read%%] [-d seconds]"
+                            " [-n cs_ns] [-l cs_lines] [-u] [-H]\n", argv[0], argv[0]);
+            return 1;
+        }
+        mode = m;
+    }
+    int n_readers, n_writers;
+    printf("Enter number of readers and writers: ");
+    if (scanf("%d %d", &n_readers, &n_writers) != 2 || n_readers < 0 || n_writers < 0)
+        return 1;
+
+    pthread_t rtid[n_readers + 1], wtid[n_writers + 1];
+    reader_wait_us = calloc(n_readers + 1, sizeof(double));
+    writer_wait_us = calloc(n_writers + 1, sizeof(double));
+
+    // Initialize semaphores and the shared copies
+    init_shared();
 
     // Create writer threads
     for (int i = 0; i < n_writers; i++) {
@@ -89,9 +914,17 @@ int main() {
     for (int i = 0; i < n_readers; i++)
         pthread_join(rtid[i], NULL);
 
+    printf("\nAcquire latency (%s):\n", mode_names[mode]);
+    print_latency("readers", reader_wait_us, n_readers);
+    print_latency("writers", writer_wait_us, n_writers);
+    free(reader_wait_us);
+    free(writer_wait_us);
+
     // Destroy semaphores
     sem_destroy(&mutex);
     sem_destroy(&wrt);
+    sem_destroy(&wmutex);
+    sem_destroy(&readtry);
 
     return 0;
 }
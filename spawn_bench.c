@@ -0,0 +1,300 @@
+/* spawn_bench.c
+ * How long does it take to start a child, and to get it back, as the
+ * parent grows? orphan.c and zombie.c use plain fork(); this compares it
+ * with the other ways of creating a process or thread.
+ *
+ *   fork         fork(), child runs on a copy of the parent's page tables
+ *   vfork        vfork() + execve() of this binary
+ *   posix_spawn  posix_spawn() of this binary
+ *   clone_vm     clone(CLONE_VM): a process that shares the parent's memory
+ *   pthread      pthread_create()
+ *
+ * "start" is the time from just before the create call until the child's
+ * first instruction (for the exec methods: the first instruction of main()
+ * in the new image). "exit" is the time until waitpid()/pthread_join()
+ * returns. The parent first maps and touches -s MB of anonymous memory, in
+ * 4 KB pages, so the cost of copying page tables shows up.
+ *
+ * Compile: gcc -Wall -O2 -pthread -o spawn_bench spawn_bench.c
+ * Run:     ./spawn_bench [-m method,...] [-s MB,...] [-n iterations] [-H]
+ *
+ *   -s  resident sizes in MB (default 1,64,512; e.g. 1,1024,8192)
+ *   -n  iterations per method and size (default 200)
+ *   -H  print the full log2 histograms
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define HIST_BUCKETS 40                     /* log2(ns) */
+#define CHILD_STACK  (64 * 1024)
+
+extern char **environ;
+
+enum method { M_FORK, M_VFORK, M_POSIX_SPAWN, M_CLONE_VM, M_PTHREAD, M_COUNT };
+static const char *method_names[M_COUNT] = {
+    "fork", "vfork", "posix_spawn", "clone_vm", "pthread"
+};
+
+static int report_fd = -1;                  /* Write end of the timestamp pipe */
+static char self_exe[4096];
+static char fd_arg[16];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* First thing every child does: tell the parent what time it is */
+static void report_start(int fd) {
+    uint64_t t = now_ns();
+    if (write(fd, &t, sizeof(t)) != sizeof(t))
+        _exit(1);
+}
+
+static int clone_child(void *arg) {
+    (void)arg;
+    report_start(report_fd);
+    return 0;
+}
+
+static void *thread_child(void *arg) {
+    (void)arg;
+    report_start(report_fd);
+    return NULL;
+}
+
+/* Create one child, wait for it; returns 0 and the two latencies in ns */
+static int spawn_once(enum method m, int rfd, char *stack, uint64_t *start_ns, uint64_t *exit_ns) {
+    char *child_argv[] = { self_exe, "--child", fd_arg, NULL };
+    pthread_t tid;
+    pid_t pid = -1;
+    uint64_t t0 = now_ns(), tchild;
+
+    switch (m) {
+    case M_FORK:
+        pid = fork();
+        if (pid == 0) {
+            report_start(report_fd);
+            _exit(0);
+        }
+        break;
+    case M_VFORK:
+        pid = vfork();
+        if (pid == 0) {
+            execve(self_exe, child_argv, environ);
+            _exit(127);
+        }
+        break;
+    case M_POSIX_SPAWN:
+        if (posix_spawn(&pid, self_exe, NULL, NULL, child_argv, environ) != 0)
+            pid = -1;
+        break;
+    case M_CLONE_VM:
+        pid = clone(clone_child, stack + CHILD_STACK, CLONE_VM | SIGCHLD, NULL);
+        break;
+    case M_PTHREAD:
+        if (pthread_create(&tid, NULL, thread_child, NULL) != 0)
+            return -1;
+        break;
+    default:
+        return -1;
+    }
+    if (m != M_PTHREAD && pid < 0)
+        return -1;
+
+    /* A child that dies before reporting must not hang the benchmark */
+    struct pollfd pfd = { rfd, POLLIN, 0 };
+    if (poll(&pfd, 1, 5000) != 1 || read(rfd, &tchild, sizeof(tchild)) != sizeof(tchild)) {
+        if (m == M_PTHREAD)
+            pthread_join(tid, NULL);
+        else
+            waitpid(pid, NULL, 0);
+        return -1;
+    }
+
+    if (m == M_PTHREAD) {
+        pthread_join(tid, NULL);
+    } else {
+        int status;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            return -1;
+    }
+    *exit_ns = now_ns() - t0;
+    *start_ns = tchild - t0;
+    return 0;
+}
+
+struct hist {
+    unsigned long count[HIST_BUCKETS];
+    uint64_t *samples;
+    int n;
+};
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void hist_add(struct hist *h, uint64_t ns) {
+    int b = ns ? 64 - __builtin_clzll(ns) : 0;
+    h->count[b < HIST_BUCKETS ? b : HIST_BUCKETS - 1]++;
+    h->samples[h->n++] = ns;
+}
+
+static void hist_print(const char *label, const struct hist *h) {
+    unsigned long peak = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++)
+        if (h->count[b] > peak)
+            peak = h->count[b];
+    printf("    %s:\n", label);
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (!h->count[b])
+            continue;
+        int bar = (int)(40.0 * h->count[b] / peak + 0.5);
+        printf("    %10.1f - %10.1f us %6lu |%.*s\n",
+               b ? (1ull << (b - 1)) / 1e3 : 0.0, ((1ull << b) - 1) / 1e3, h->count[b], bar,
+               "########################################");
+    }
+}
+
+static int parse_list(const char *s, long out[], int max) {
+    int n = 0;
+    char *end;
+    while (*s && n < max) {
+        long v = strtol(s, &end, 10);
+        if (end == s || v <= 0)
+            return -1;
+        out[n++] = v;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return *s ? -1 : n;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "--child") == 0) {
+        report_start(atoi(argv[2]));
+        return 0;
+    }
+
+    long sizes[16] = { 1, 64, 512 };
+    int nsizes = 3, iterations = 200, histograms = 0, opt;
+    int enabled[M_COUNT] = { 1, 1, 1, 1, 1 };
+
+    while ((opt = getopt(argc, argv, "m:s:n:H")) != -1) {
+        switch (opt) {
+        case 'm':
+            memset(enabled, 0, sizeof(enabled));
+            for (char *tok = strtok(optarg, ","); tok; tok = strtok(NULL, ",")) {
+                int m;
+                for (m = 0; m < M_COUNT && strcmp(tok, method_names[m]) != 0; m++)
+                    ;
+                if (m == M_COUNT) {
+                    fprintf(stderr, "Unknown method '%s'\n", tok);
+                    return EXIT_FAILURE;
+                }
+                enabled[m] = 1;
+            }
+            break;
+        case 's': nsizes = parse_list(optarg, sizes, 16); break;
+        case 'n': iterations = atoi(optarg); break;
+        case 'H': histograms = 1; break;
+        default:  return EXIT_FAILURE;
+        }
+    }
+    if (nsizes <= 0 || iterations <= 0) {
+        fprintf(stderr, "Invalid arguments.\n");
+        return EXIT_FAILURE;
+    }
+
+    ssize_t len = readlink("/proc/self/exe", self_exe, sizeof(self_exe) - 1);
+    if (len < 0) {
+        perror("readlink");
+        return EXIT_FAILURE;
+    }
+    self_exe[len] = '\0';
+
+    int pfd[2];
+    if (pipe(pfd) < 0) {
+        perror("pipe");
+        return EXIT_FAILURE;
+    }
+    report_fd = pfd[1];
+    snprintf(fd_arg, sizeof(fd_arg), "%d", pfd[1]);
+
+    char *stack = malloc(CHILD_STACK);
+    struct hist start, exit_h;
+    start.samples = malloc(iterations * sizeof(uint64_t));
+    exit_h.samples = malloc(iterations * sizeof(uint64_t));
+
+    printf("%d iterations, latencies in us\n", iterations);
+    printf("%-12s %8s %9s %9s %9s %9s %9s %9s\n", "method", "RSS MB",
+           "start p50", "p99", "max", "exit p50", "p99", "max");
+
+    for (int si = 0; si < nsizes; si++) {
+        size_t bytes = (size_t)sizes[si] << 20;
+        char *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            perror("mmap");
+            return EXIT_FAILURE;
+        }
+        madvise(mem, bytes, MADV_NOHUGEPAGE);
+        memset(mem, 1, bytes);
+
+        for (int m = 0; m < M_COUNT; m++) {
+            if (!enabled[m])
+                continue;
+            memset(start.count, 0, sizeof(start.count));
+            memset(exit_h.count, 0, sizeof(exit_h.count));
+            start.n = exit_h.n = 0;
+
+            int failed = 0;
+            for (int i = 0; i < iterations && !failed; i++) {
+                uint64_t s, e;
+                if (spawn_once(m, pfd[0], stack, &s, &e) < 0)
+                    failed = 1;
+                else {
+                    hist_add(&start, s);
+                    hist_add(&exit_h, e);
+                }
+            }
+            if (failed) {
+                printf("%-12s %8ld failed: %s\n", method_names[m], sizes[si], strerror(errno));
+                continue;
+            }
+
+            qsort(start.samples, start.n, sizeof(uint64_t), cmp_u64);
+            qsort(exit_h.samples, exit_h.n, sizeof(uint64_t), cmp_u64);
+            printf("%-12s %8ld %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", method_names[m], sizes[si],
+                   start.samples[start.n / 2] / 1e3, start.samples[(int)(start.n * 0.99)] / 1e3,
+                   start.samples[start.n - 1] / 1e3,
+                   exit_h.samples[exit_h.n / 2] / 1e3, exit_h.samples[(int)(exit_h.n * 0.99)] / 1e3,
+                   exit_h.samples[exit_h.n - 1] / 1e3);
+            if (histograms) {
+                hist_print("start", &start);
+                hist_print("exit", &exit_h);
+            }
+        }
+        munmap(mem, bytes);
+    }
+
+    free(stack);
+    free(start.samples);
+    free(exit_h.samples);
+    return EXIT_SUCCESS;
+}
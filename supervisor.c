@@ -0,0 +1,349 @@
+/* supervisor.c
+ * Spawns many short-lived children and reaps them promptly, the opposite of
+ * zombie.c (parent never waits) and orphan.c (parent exits first).
+ *
+ * Compile: gcc -Wall -O2 -o supervisor supervisor.c
+ * Run:     ./supervisor [-n jobs] [-c concurrency] [-m pidfd|signalfd]
+ *                       [-f fail%] [-r restarts] [-- command [args...]]
+ *
+ *   -n  number of jobs to run to completion (default 20000)
+ *   -c  maximum children alive at once (default 64)
+ *   -m  how exits are collected: a pidfd per child, or one signalfd for
+ *       SIGCHLD, both waited on with epoll (default pidfd)
+ *   -f  built-in child exits with status 1 this percent of the time
+ *   -r  restarts allowed per job after a failure (default 3); restarts are
+ *       delayed by an exponential backoff starting at 1 ms, capped at 1 s
+ *
+ * Without a command each child calls _exit() straight away. Spawn-to-reap
+ * latency percentiles are printed at the end, followed by a check that no
+ * child was left unreaped.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define BACKOFF_MIN_NS  1000000ull          /* 1 ms */
+#define BACKOFF_MAX_NS  1000000000ull       /* 1 s */
+#define MAX_EVENTS      256
+
+extern char **environ;
+
+enum reap_method { REAP_PIDFD, REAP_SIGNALFD };
+
+struct job {
+    int restarts;                           /* Failed attempts so far */
+    uint64_t not_before;                    /* Backoff: earliest restart time */
+};
+
+struct slot {
+    pid_t pid;                              /* 0 when free */
+    int pidfd;
+    int job;
+    uint64_t spawned;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static long read_pid_max(void) {
+    long max = 4194304;
+    FILE *f = fopen("/proc/sys/kernel/pid_max", "r");
+    if (f) {
+        if (fscanf(f, "%ld", &max) != 1)
+            max = 4194304;
+        fclose(f);
+    }
+    return max;
+}
+
+/* Exponential backoff before restart number `restarts` + 1 */
+static uint64_t backoff_ns(int restarts) {
+    uint64_t backoff = BACKOFF_MIN_NS << (restarts < 30 ? restarts : 30);
+    return backoff < BACKOFF_MAX_NS ? backoff : BACKOFF_MAX_NS;
+}
+
+/* Start one child; returns its pid or -1 */
+static pid_t spawn_child(char **cmd, int fail_pct, unsigned *seed) {
+    if (cmd) {
+        /* Do not pass a blocked SIGCHLD on to the command */
+        posix_spawnattr_t attr;
+        sigset_t empty;
+        pid_t pid;
+        sigemptyset(&empty);
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setsigmask(&attr, &empty);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+        int err = posix_spawnp(&pid, cmd[0], NULL, &attr, cmd, environ);
+        posix_spawnattr_destroy(&attr);
+        if (err) {
+            errno = err;
+            return -1;
+        }
+        return pid;
+    }
+
+    int status = (int)(rand_r(seed) % 100) < fail_pct ? 1 : 0;
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(status);
+    return pid;
+}
+
+int main(int argc, char **argv) {
+    long njobs = 20000;
+    int concurrency = 64, max_restarts = 3, fail_pct = 0, opt;
+    enum reap_method method = REAP_PIDFD;
+    char **cmd = NULL;
+
+    while ((opt = getopt(argc, argv, "n:c:m:f:r:")) != -1) {
+        switch (opt) {
+        case 'n': njobs = atol(optarg); break;
+        case 'c': concurrency = atoi(optarg); break;
+        case 'f': fail_pct = atoi(optarg); break;
+        case 'r': max_restarts = atoi(optarg); break;
+        case 'm':
+            if (strcmp(optarg, "pidfd") == 0) method = REAP_PIDFD;
+            else if (strcmp(optarg, "signalfd") == 0) method = REAP_SIGNALFD;
+            else { fprintf(stderr, "Unknown method '%s'\n", optarg); return EXIT_FAILURE; }
+            break;
+        default:
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc)
+        cmd = &argv[optind];
+    if (njobs <= 0 || concurrency <= 0 || max_restarts < 0) {
+        fprintf(stderr, "Invalid arguments.\n");
+        return EXIT_FAILURE;
+    }
+
+    struct job *jobs = calloc(njobs, sizeof(*jobs));
+    struct slot *slots = calloc(concurrency, sizeof(*slots));
+    int *free_slots = malloc(concurrency * sizeof(int));
+    int nfree = concurrency;
+    long pid_max = read_pid_max();
+    int *slot_of_pid = calloc(pid_max + 1, sizeof(int));   /* slot + 1, 0 = none */
+    size_t lat_cap = njobs * (size_t)(max_restarts + 1);
+    uint64_t *latency = malloc(lat_cap * sizeof(*latency));
+    /* Jobs waiting to (re)start, FIFO; a job is queued at most once */
+    long *queue = malloc(njobs * sizeof(*queue));
+    long qhead = 0, qtail = 0, qlen = 0;
+    /* Exits collected by one epoll event; never more than the children alive */
+    pid_t *pids = malloc(concurrency * sizeof(*pids));
+    int *statuses = malloc(concurrency * sizeof(*statuses));
+    if (!jobs || !slots || !free_slots || !slot_of_pid || !latency || !queue || !pids || !statuses) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < concurrency; i++)
+        free_slots[i] = concurrency - 1 - i;
+    for (long j = 0; j < njobs; j++) {
+        queue[qtail] = j;
+        qtail = (qtail + 1) % njobs;
+        qlen++;
+    }
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    int sfd = -1;
+    if (ep < 0) {
+        perror("epoll_create1");
+        return EXIT_FAILURE;
+    }
+    if (method == REAP_SIGNALFD) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &mask, NULL);
+        sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = UINT32_MAX };
+        if (sfd < 0 || epoll_ctl(ep, EPOLL_CTL_ADD, sfd, &ev) < 0) {
+            perror("signalfd");
+            return EXIT_FAILURE;
+        }
+    }
+
+    long spawned = 0, succeeded = 0, failed = 0, restarted = 0, given_up = 0;
+    size_t nlat = 0;
+    int alive = 0;
+    unsigned seed = 12345;
+    uint64_t start = now_ns();
+
+    while (qlen > 0 || alive > 0) {
+        /* Fill free slots with jobs whose backoff has expired */
+        uint64_t now = now_ns(), next_due = UINT64_MAX;
+        for (long scanned = qlen; scanned > 0 && nfree > 0; scanned--) {
+            long j = queue[qhead];
+            qhead = (qhead + 1) % njobs;
+            qlen--;
+            if (jobs[j].not_before > now) {
+                if (jobs[j].not_before < next_due)
+                    next_due = jobs[j].not_before;
+                queue[qtail] = j;               /* Not yet: back of the queue */
+                qtail = (qtail + 1) % njobs;
+                qlen++;
+                continue;
+            }
+
+            int s = free_slots[--nfree];
+            pid_t pid = spawn_child(cmd, fail_pct, &seed);
+            if (pid < 0) {
+                /* A failed spawn is a failed attempt, with the same limit
+                 * and backoff as a child that exits non-zero */
+                perror("spawn");
+                free_slots[nfree++] = s;
+                failed++;
+                if (jobs[j].restarts < max_restarts) {
+                    jobs[j].not_before = now + backoff_ns(jobs[j].restarts++);
+                    if (jobs[j].not_before < next_due)
+                        next_due = jobs[j].not_before;
+                    queue[qtail] = j;
+                    qtail = (qtail + 1) % njobs;
+                    qlen++;
+                    restarted++;
+                } else {
+                    given_up++;
+                }
+                continue;
+            }
+            slots[s] = (struct slot){ pid, -1, (int)j, now_ns() };
+            if (pid <= pid_max)
+                slot_of_pid[pid] = s + 1;
+            if (method == REAP_PIDFD) {
+                slots[s].pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+                struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)s };
+                if (slots[s].pidfd < 0 || epoll_ctl(ep, EPOLL_CTL_ADD, slots[s].pidfd, &ev) < 0) {
+                    perror("pidfd_open");
+                    return EXIT_FAILURE;
+                }
+            }
+            spawned++;
+            alive++;
+        }
+
+        if (qlen == 0 && alive == 0)
+            break;                              /* Last jobs gave up without spawning */
+
+        int timeout = -1;
+        if (qlen > 0 && nfree > 0 && next_due != UINT64_MAX) {
+            uint64_t wait = next_due > now_ns() ? next_due - now_ns() : 0;
+            timeout = (int)((wait + 999999) / 1000000);
+        }
+
+        struct epoll_event events[MAX_EVENTS];
+        int nev = epoll_wait(ep, events, MAX_EVENTS, timeout);
+        if (nev < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            return EXIT_FAILURE;
+        }
+
+        for (int e = 0; e < nev; e++) {
+            int nreaped = 0;
+
+            if (events[e].data.u32 == UINT32_MAX) {
+                struct signalfd_siginfo si;
+                while (read(sfd, &si, sizeof(si)) == sizeof(si))
+                    ;                           /* SIGCHLDs coalesce: just drain */
+                pid_t pid;
+                int status;
+                while (nreaped < concurrency && (pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                    pids[nreaped] = pid;
+                    statuses[nreaped++] = status;
+                }
+            } else {
+                struct slot *sl = &slots[events[e].data.u32];
+                int status;
+                if (waitpid(sl->pid, &status, WNOHANG) == sl->pid) {
+                    pids[nreaped] = sl->pid;
+                    statuses[nreaped++] = status;
+                }
+            }
+
+            for (int r = 0; r < nreaped; r++) {
+                pid_t pid = pids[r];
+                int s = pid <= pid_max ? slot_of_pid[pid] - 1 : -1;
+                if (s < 0) {
+                    for (s = 0; s < concurrency && slots[s].pid != pid; s++)
+                        ;
+                    if (s == concurrency)
+                        continue;               /* Not ours */
+                }
+                struct slot *sl = &slots[s];
+                uint64_t reaped = now_ns();
+                if (nlat < lat_cap)
+                    latency[nlat++] = reaped - sl->spawned;
+
+                if (sl->pidfd >= 0) {
+                    epoll_ctl(ep, EPOLL_CTL_DEL, sl->pidfd, NULL);
+                    close(sl->pidfd);
+                }
+                if (pid <= pid_max)
+                    slot_of_pid[pid] = 0;
+
+                struct job *jb = &jobs[sl->job];
+                int ok = WIFEXITED(statuses[r]) && WEXITSTATUS(statuses[r]) == 0;
+                if (ok) {
+                    succeeded++;
+                } else {
+                    failed++;
+                    if (jb->restarts < max_restarts) {
+                        jb->not_before = reaped + backoff_ns(jb->restarts++);
+                        queue[qtail] = sl->job;
+                        qtail = (qtail + 1) % njobs;
+                        qlen++;
+                        restarted++;
+                    } else {
+                        given_up++;
+                    }
+                }
+                sl->pid = 0;
+                free_slots[nfree++] = s;
+                alive--;
+            }
+        }
+    }
+
+    double elapsed = (now_ns() - start) / 1e9;
+    printf("method %s, concurrency %d: %ld spawned, %ld ok, %ld failed, %ld restarted, %ld given up\n",
+           method == REAP_PIDFD ? "pidfd" : "signalfd", concurrency,
+           spawned, succeeded, failed, restarted, given_up);
+    printf("%.3f s, %.0f exits/s\n", elapsed, spawned / elapsed);
+    if (nlat > 0) {
+        qsort(latency, nlat, sizeof(*latency), cmp_u64);
+        printf("spawn-to-reap latency: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+               latency[nlat / 2] / 1e3, latency[(size_t)(nlat * 0.99)] / 1e3,
+               latency[nlat - 1] / 1e3);
+    }
+
+    /* Every child must already be reaped: waitpid should find none */
+    if (waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD)
+        printf("No zombies left.\n");
+    else
+        printf("WARNING: unreaped children remain.\n");
+
+    free(jobs); free(slots); free(free_slots); free(slot_of_pid); free(latency); free(queue);
+    free(pids); free(statuses);
+    return given_up ? EXIT_FAILURE : EXIT_SUCCESS;
+}